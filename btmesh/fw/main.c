@@ -18,9 +18,14 @@
  * @}
  */
 
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include "irq.h"
+#include "mutex.h"
+#include "sched.h"
 #include "thread.h"
 #include "shell.h"
 #include "random.h"
@@ -31,6 +36,7 @@
 #include "host/myfilter.h"
 
 #include "host/ble_hs.h"
+#include "os/os_mempool.h"
 #include "mesh/glue.h"
 #include "mesh/porting.h"
 #include "mesh/access.h"
@@ -38,12 +44,23 @@
 #include "mesh/cfg_srv.h"
 #include "host/mystats.h"
 
+#include "fmt.h"
 #include "luid.h"
+#include "xtimer.h"
 #include "mesh/cfg_cli.h"
 
+/* needed for writing the app key directly into the local key store */
+#include "net.h"
+#include "crypto.h"
+/* needed for counting segments on their way through the lower transport */
+#include "transport.h"
+/* needed for the transmit count of queued advertising buffers */
+#include "adv.h"
+
 #define EXP_INTERVAL            (1U * US_PER_SEC)   /* default: 1 pkt per sec */
 #define EXP_JITTER              (500U * US_PER_MS)  /* default: .5 sec jitter */
 #define EXP_REPEAT              (100U)              /* default: 100 packets */
+#define EXP_SLOTS               (10U)               /* default: 10 TX slots */
 
 #define VENDOR_CID              0x2342              /* random... */
 
@@ -57,6 +74,42 @@
 #define OP_LVL_SET_UNACK        BT_MESH_MODEL_OP_2(0x82, 0x07)
 #define OP_LVL_STATUS           BT_MESH_MODEL_OP_2(0x82, 0x08)
 
+#define VND_MODEL_ID_AGG_SRV    (0x0001)
+#define VND_MODEL_ID_AGG_CLI    (0x0002)
+#define OP_VND_AGG              BT_MESH_MODEL_OP_3(0x01, VENDOR_CID)
+
+/* aggregate message: 3 byte opcode and 2 byte source address, followed by
+ * a batch of readings, each consisting of an 8-bit sequence number and a
+ * 16-bit value. Up to AGG_UNSEG_MAX readings fit into a single unsegmented
+ * access PDU, larger batches are sent segmented. */
+#define AGG_HDR_LEN             (3U + 2U)
+#define AGG_READING_LEN         (3U)
+#define AGG_UNSEG_SDU_MAX       (11U)
+#define AGG_UNSEG_MAX           ((AGG_UNSEG_SDU_MAX - AGG_HDR_LEN) / AGG_READING_LEN)
+#ifndef AGG_SDU_MAX
+#define AGG_SDU_MAX             ((MYNEWT_VAL(BLE_MESH_TX_SEG_MAX) * 12U) - 4U)
+#endif
+#define AGG_BATCH_MAX           ((AGG_SDU_MAX - AGG_HDR_LEN) / AGG_READING_LEN)
+
+#define OP_VND_SEG              BT_MESH_MODEL_OP_3(0x02, VENDOR_CID)
+
+/* segmentation benchmark message: 3 byte opcode, followed by `size` bytes
+ * consisting of the 2 byte source address, a 16-bit sequence number and a
+ * fill pattern derived from the sequence number. Each segment carries up to
+ * 12 bytes of the access PDU, which includes a 4 byte TransMIC. */
+#define SEG_HDR_LEN             (2U + 2U)
+#define SEG_SIZE_MAX            (AGG_SDU_MAX - 3U)
+#define SEG_SEG_LEN             (12U)
+#define SEG_MIC_LEN             (4U)
+#define SEG_CNT(size)           ((((size) + 3U) <= AGG_UNSEG_SDU_MAX) ? 1U : \
+                                 (((size) + 3U + SEG_MIC_LEN + SEG_SEG_LEN - 1U) \
+                                  / SEG_SEG_LEN))
+
+/* lower transport PDU header fields */
+#define LTP_SEG                 (0x80)
+#define LTP_CTL_OP_MASK         (0x7f)
+#define LTP_CTL_OP_ACK          (0x00)
+
 /* shell thread env */
 static char _stack_mesh[NIMBLE_MESH_STACKSIZE];
 
@@ -74,10 +127,31 @@ static char _stack_mesh[NIMBLE_MESH_STACKSIZE];
 #define PROV_FLAGS              (0U)
 
 #define PROV_ADDR_GROUP0        (0xc001)
+#define PROV_GROUPS_MAX         (64U)
+#define PROV_PUB_TTL            (15U)
+#define PROV_PUB_TRANSMIT       (0U)
+
+/* layout of the binary provisioning blob used by the `prov` command:
+ *   [0]     role flags (PROV_ROLE_x)
+ *   [1-2]   first group address (little endian)
+ *   [3]     number of consecutive groups to publish to / subscribe to
+ *   [4]     publish TTL
+ *   [5]     publish retransmit (BT_MESH_PUB_TRANSMIT encoding)
+ *   [6-21]  app key (optional, PROV_KEY_APP is used if omitted) */
+#define PROV_ROLE_SOURCE        (0x01)
+#define PROV_ROLE_SINK          (0x02)
+#define PROV_BLOB_HDR_LEN       (6U)
+#define PROV_BLOB_MAX_LEN       (PROV_BLOB_HDR_LEN + 16U)
 
 #define ADDR_SERVER             (_addr_node + 1)
 #define ADDR_CLIENT             (_addr_node + 2)
 
+/* value logged by mystats for a sent or received application message: the
+ * source address in the upper and the message's value in the lower 16 bit,
+ * so the log analyzer can tell apart equal values of different sources */
+#define APP_VAL(src, val)       ((((unsigned)(src)) << 16) | \
+                                 (((unsigned)(val)) & 0xffff))
+
 static const uint8_t _key_net[16] = PROV_KEY_NET;
 static const uint8_t _key_app[16] = PROV_KEY_APP;
 static uint8_t _key_dev[16];
@@ -86,6 +160,92 @@ static uint16_t _addr_node;
 static uint8_t _trans_id = 0;
 static int _is_provisioned = 0;
 
+/* sources publish round-robin over _pub_groups groups, sinks count received
+ * messages per subscribed group */
+static uint16_t _group_base = PROV_ADDR_GROUP0;
+static unsigned _pub_groups = 1;
+static unsigned _pub_group_next = 0;
+static unsigned _rx_group[PROV_GROUPS_MAX];
+static unsigned _rx_other = 0;
+
+/* aggregate messages sent and received, their readings are accounted
+ * individually in mystats */
+static unsigned _tx_agg_msgs = 0;
+static unsigned _rx_agg_msgs = 0;
+static unsigned _rx_readings = 0;
+
+/* segmentation benchmark, sender side */
+static mutex_t _seg_lock = MUTEX_INIT;
+static uint32_t _seg_t_start = 0;
+static unsigned _seg_tx_msgs = 0;
+static unsigned _seg_tx_done = 0;
+static unsigned _seg_tx_fail = 0;
+static uint32_t _seg_tx_bytes = 0;
+static uint64_t _seg_lat_sum = 0;
+static uint32_t _seg_lat_min = UINT32_MAX;
+static uint32_t _seg_lat_max = 0;
+static uint32_t _seg_t_first = 0;
+static uint32_t _seg_t_last = 0;
+
+/* segmentation benchmark, receiver side */
+static unsigned _seg_rx_msgs = 0;
+static unsigned _seg_rx_corrupt = 0;
+static uint32_t _seg_rx_bytes = 0;
+static uint32_t _seg_rx_t_first = 0;
+static uint32_t _seg_rx_t_last = 0;
+
+/* lower transport counters, collected by wrapping bt_mesh_net_send(),
+ * bt_mesh_net_resend() and bt_mesh_trans_recv() (see the Makefile). Only
+ * segmented access messages addressed to this node are counted, they are told
+ * apart by (src, SeqZero) over the last SEG_RX_TRACK ones. Those that never
+ * reach a model handler count as failed reassembly. */
+#define SEG_RX_TRACK            (8U)
+
+static struct {
+    unsigned tx_segs;
+    unsigned tx_retrans;
+    unsigned tx_acks;
+    unsigned rx_segs;
+    unsigned rx_acks;
+    unsigned rx_msgs;
+    unsigned rx_done;
+} _ltp;
+static uint32_t _ltp_rx_track[SEG_RX_TRACK];
+static unsigned _ltp_rx_track_next = 0;
+
+/* estimated transmit airtime. Every network PDU handed to the advertiser is
+ * sent in (transmit count + 1) advertising events, each on all three
+ * advertising channels. PDUs sent through bt_mesh_net_send() and
+ * bt_mesh_net_resend() are originated by this node, all others are relayed.
+ * The on-air frame on the 1M PHY consists of preamble, access address, PDU
+ * header, AdvA, AD length and type, the network PDU and CRC. */
+#define AIR_US_PER_BYTE         (8U)
+#define AIR_ADV_OVERHEAD        (1U + 4U + 2U + 6U + 2U + 3U)
+#define AIR_ADV_CHANNELS        (3U)
+
+enum {
+    AIR_ORIGIN,
+    AIR_RELAY,
+    AIR_NUMOF,
+};
+
+typedef struct {
+    unsigned events;
+    unsigned frames;
+    uint32_t bytes;
+    uint32_t us;
+} air_cnt_t;
+
+static air_cnt_t _air[AIR_NUMOF];
+static const char *_air_names[AIR_NUMOF] = { "orig", "relay" };
+static bool _air_origin[KERNEL_PID_LAST + 1];
+
+/* per thread runtime and system time when the current CPU measurement window
+ * was started (xtimer ticks), the window is restarted by `clr` and by each
+ * run command */
+static uint64_t _cpu_ticks[KERNEL_PID_LAST + 1];
+static uint64_t _cpu_t_start = 0;
+
 static struct bt_mesh_cfg_srv _cfg_srv = {
     .relay = BT_MESH_RELAY_ENABLED,
     .beacon = BT_MESH_BEACON_DISABLED,
@@ -106,14 +266,32 @@ static struct bt_mesh_model _models_root[] = {
     BT_MESH_MODEL_CFG_CLI(&_cfg_cli),
 };
 
+static void _count_rx(struct bt_mesh_msg_ctx *ctx)
+{
+    unsigned grp = (unsigned)(ctx->recv_dst - _group_base);
+    if (BT_MESH_ADDR_IS_GROUP(ctx->recv_dst) && (grp < PROV_GROUPS_MAX)) {
+        _rx_group[grp]++;
+    }
+    else {
+        _rx_other++;
+    }
+}
+
+static uint16_t _pub_group_get(void)
+{
+    uint16_t addr = (uint16_t)(_group_base + _pub_group_next);
+    _pub_group_next = (_pub_group_next + 1) % _pub_groups;
+    return addr;
+}
+
 static void _op_lvl_get(struct bt_mesh_model *model,
                         struct bt_mesh_msg_ctx *ctx,
                         struct os_mbuf *buf)
 {
     (void)model;
-    (void)ctx;
     (void)buf;
-    mystats_inc_rx_app("lvl_get", 0);
+    _count_rx(ctx);
+    mystats_inc_rx_app("lvl_get", APP_VAL(ctx->addr, 0));
 }
 
 static void _op_lvl_set(struct bt_mesh_model *model,
@@ -121,9 +299,9 @@ static void _op_lvl_set(struct bt_mesh_model *model,
                         struct os_mbuf *buf)
 {
     (void)model;
-    (void)ctx;
+    _count_rx(ctx);
     unsigned level = (unsigned)net_buf_simple_pull_le16(buf);
-    mystats_inc_rx_app("lvl_set", level);
+    mystats_inc_rx_app("lvl_set", APP_VAL(ctx->addr, level));
 }
 
 static void _op_lvl_set_unack(struct bt_mesh_model *model,
@@ -131,9 +309,9 @@ static void _op_lvl_set_unack(struct bt_mesh_model *model,
                         struct os_mbuf *buf)
 {
     (void)model;
-    (void)ctx;
+    _count_rx(ctx);
     unsigned level = (unsigned)net_buf_simple_pull_le16(buf);
-    mystats_inc_rx_app("lvl_set_unack", level);
+    mystats_inc_rx_app("lvl_set_unack", APP_VAL(ctx->addr, level));
 }
 
 static void _op_lvl_status(struct bt_mesh_model *model,
@@ -141,9 +319,9 @@ static void _op_lvl_status(struct bt_mesh_model *model,
                            struct os_mbuf *buf)
 {
     (void)model;
-    (void)ctx;
+    _count_rx(ctx);
     unsigned level = (unsigned)net_buf_simple_pull_le16(buf);
-    mystats_inc_rx_app("lvl_status", level);
+    mystats_inc_rx_app("lvl_status", APP_VAL(ctx->addr, level));
 }
 
 static void _send_status(struct bt_mesh_model *model,
@@ -152,7 +330,9 @@ static void _send_status(struct bt_mesh_model *model,
 {
     (void)buf;
 
-    mystats_inc_tx_app("status", (unsigned)_trans_id++);
+    /* log the value that is sent */
+    _trans_id++;
+    mystats_inc_tx_app("status", APP_VAL(ADDR_SERVER, _trans_id));
     struct os_mbuf *msg = NET_BUF_SIMPLE(2 + 1 + 4);
     bt_mesh_model_msg_init(msg, OP_STATUS);
     net_buf_simple_add_u8(msg, _trans_id);  /* intentional missusage here */
@@ -166,7 +346,8 @@ static void _op_get(struct bt_mesh_model *model,
                     struct bt_mesh_msg_ctx *ctx,
                     struct os_mbuf *buf)
 {
-    mystats_inc_rx_app("get", (unsigned)buf->om_data[1]);
+    _count_rx(ctx);
+    mystats_inc_rx_app("get", APP_VAL(ctx->addr, buf->om_data[1]));
     _send_status(model, ctx, buf);
 }
 
@@ -175,8 +356,8 @@ static void _op_set_unack(struct bt_mesh_model *model,
                           struct os_mbuf *buf)
 {
     (void)model;
-    (void)ctx;
-    mystats_inc_rx_app("set_unack", (unsigned)buf->om_data[1]);
+    _count_rx(ctx);
+    mystats_inc_rx_app("set_unack", APP_VAL(ctx->addr, buf->om_data[1]));
     // printf("OP_SET_UNACK val %i, tid %i\n",
            // (int)buf->om_data[0], (int)buf->om_data[1]);
 }
@@ -187,7 +368,8 @@ static void _op_set(struct bt_mesh_model *model,
 {
     // printf("OP_SET val %i, tid %i\n",
            // (int)buf->om_data[0], (int)buf->om_data[1]);
-    mystats_inc_rx_app("set", (unsigned)buf->om_data[1]);
+    _count_rx(ctx);
+    mystats_inc_rx_app("set", APP_VAL(ctx->addr, buf->om_data[1]));
     _send_status(model, ctx, buf);
 }
 
@@ -196,11 +378,71 @@ static void _op_status(struct bt_mesh_model *model,
                        struct os_mbuf *buf)
 {
     (void)model;
-    (void)ctx;
-    mystats_inc_rx_app("stats", (unsigned)buf->om_data[0]);
+    _count_rx(ctx);
+    mystats_inc_rx_app("stats", APP_VAL(ctx->addr, buf->om_data[0]));
     // printf("OP_STATUS tid %i\n", (int)buf->om_data[0]);
 }
 
+/* called by the handlers of messages that may arrive segmented, with the
+ * access payload following the 3 byte vendor opcode */
+static void _ltp_rx_done(const struct os_mbuf *buf)
+{
+    if ((3U + buf->om_len) > AGG_UNSEG_SDU_MAX) {
+        _ltp.rx_done++;
+    }
+}
+
+static void _op_vnd_agg(struct bt_mesh_model *model,
+                        struct bt_mesh_msg_ctx *ctx,
+                        struct os_mbuf *buf)
+{
+    (void)model;
+    _ltp_rx_done(buf);
+    _count_rx(ctx);
+    _rx_agg_msgs++;
+    unsigned src = (unsigned)net_buf_simple_pull_le16(buf);
+    while (buf->om_len >= AGG_READING_LEN) {
+        (void)net_buf_simple_pull_u8(buf);      /* sequence number */
+        unsigned level = (unsigned)net_buf_simple_pull_le16(buf);
+        mystats_inc_rx_app("agg", APP_VAL(src, level));
+        _rx_readings++;
+    }
+}
+
+static bool _seg_fill_check(struct os_mbuf *buf, unsigned seq)
+{
+    for (unsigned i = 0; i < buf->om_len; i++) {
+        if (buf->om_data[i] != (uint8_t)(seq + i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void _op_vnd_seg(struct bt_mesh_model *model,
+                        struct bt_mesh_msg_ctx *ctx,
+                        struct os_mbuf *buf)
+{
+    (void)model;
+    uint32_t now = xtimer_now_usec();
+    unsigned size = buf->om_len;
+
+    _ltp_rx_done(buf);
+    _count_rx(ctx);
+    unsigned src = (unsigned)net_buf_simple_pull_le16(buf);
+    unsigned seq = (unsigned)net_buf_simple_pull_le16(buf);
+    if (!_seg_fill_check(buf, seq)) {
+        _seg_rx_corrupt++;
+        return;
+    }
+    mystats_inc_rx_app("seg", APP_VAL(src, seq));
+    if (_seg_rx_msgs++ == 0) {
+        _seg_rx_t_first = now;
+    }
+    _seg_rx_t_last = now;
+    _seg_rx_bytes += size;
+}
+
 static const struct bt_mesh_model_op _lvl_svr_op[] = {
     { OP_LVL_GET, 0, _op_lvl_get },
     { OP_LVL_SET, 3, _op_lvl_set },
@@ -225,7 +467,18 @@ static const struct bt_mesh_model_op _btn_op[] = {
     BT_MESH_MODEL_OP_END,
 };
 
+static const struct bt_mesh_model_op _vnd_svr_op[] = {
+    { OP_VND_AGG, (2 + AGG_READING_LEN), _op_vnd_agg },
+    { OP_VND_SEG, SEG_HDR_LEN, _op_vnd_seg },
+    BT_MESH_MODEL_OP_END,
+};
+
+static const struct bt_mesh_model_op _vnd_cli_op[] = {
+    BT_MESH_MODEL_OP_END,
+};
+
 static struct bt_mesh_model_pub _s_pub[4];
+static struct bt_mesh_model_pub _s_pub_vnd[2];
 
 static struct bt_mesh_model _models_svr[] = {
     BT_MESH_MODEL(BT_MESH_MODEL_ID_GEN_ONOFF_SRV, _led_op,
@@ -241,10 +494,20 @@ static struct bt_mesh_model _models_cli[] = {
                   &_s_pub[3], (void *)0),
 };
 
+static struct bt_mesh_model _models_svr_vnd[] = {
+    BT_MESH_MODEL_VND(VENDOR_CID, VND_MODEL_ID_AGG_SRV, _vnd_svr_op,
+                      &_s_pub_vnd[0], (void *)0),
+};
+
+static struct bt_mesh_model _models_cli_vnd[] = {
+    BT_MESH_MODEL_VND(VENDOR_CID, VND_MODEL_ID_AGG_CLI, _vnd_cli_op,
+                      &_s_pub_vnd[1], (void *)0),
+};
+
 static struct bt_mesh_elem _elements[] = {
     BT_MESH_ELEM(0, _models_root, BT_MESH_MODEL_NONE),
-    BT_MESH_ELEM(0, _models_svr, BT_MESH_MODEL_NONE),
-    BT_MESH_ELEM(0, _models_cli, BT_MESH_MODEL_NONE),
+    BT_MESH_ELEM(0, _models_svr, _models_svr_vnd),
+    BT_MESH_ELEM(0, _models_cli, _models_cli_vnd),
 };
 
 static const struct bt_mesh_comp _node_comp = {
@@ -278,8 +541,91 @@ static void _dump_key(const uint8_t *key)
     printf("%02x", (int)key[15]);
 }
 
+static void _print_ready(const char *what, uint32_t t_start)
+{
+    uint32_t t_ready = xtimer_now_usec();
+    printf("%s ready after %lu us (boot +%lu us)\n", what,
+           (unsigned long)(t_ready - t_start), (unsigned long)t_ready);
+}
+
+static int _local_app_key_add(uint16_t net_idx, uint16_t app_idx,
+                              const uint8_t *key)
+{
+    struct bt_mesh_app_key *slot = NULL;
+
+    /* this mirrors what the config server does on APP_KEY_ADD, but without
+     * looping the request through the config client and the access layer */
+    for (unsigned i = 0; i < ARRAY_SIZE(bt_mesh.app_keys); i++) {
+        struct bt_mesh_app_key *ak = &bt_mesh.app_keys[i];
+        if (ak->app_idx == app_idx && ak->net_idx != BT_MESH_KEY_UNUSED) {
+            slot = ak;
+            break;
+        }
+        if (!slot && ak->net_idx == BT_MESH_KEY_UNUSED) {
+            slot = ak;
+        }
+    }
+    if (slot == NULL) {
+        return -ENOMEM;
+    }
+
+    if (bt_mesh_app_id(key, &slot->keys[0].id) != 0) {
+        return -EIO;
+    }
+    memcpy(slot->keys[0].val, key, 16);
+    slot->updated = false;
+    slot->app_idx = app_idx;
+    slot->net_idx = net_idx;
+    return 0;
+}
+
+static int _local_mod_bind(struct bt_mesh_model *model, uint16_t app_idx)
+{
+    for (unsigned i = 0; i < ARRAY_SIZE(model->keys); i++) {
+        if (model->keys[i] == app_idx) {
+            return 0;
+        }
+    }
+    for (unsigned i = 0; i < ARRAY_SIZE(model->keys); i++) {
+        if (model->keys[i] == BT_MESH_KEY_UNUSED) {
+            model->keys[i] = app_idx;
+            return 0;
+        }
+    }
+    return -ENOMEM;
+}
+
+static int _local_mod_sub_add(struct bt_mesh_model *model, uint16_t group)
+{
+    for (unsigned i = 0; i < ARRAY_SIZE(model->groups); i++) {
+        if (model->groups[i] == group) {
+            return 0;
+        }
+    }
+    for (unsigned i = 0; i < ARRAY_SIZE(model->groups); i++) {
+        if (model->groups[i] == BT_MESH_ADDR_UNASSIGNED) {
+            model->groups[i] = group;
+            return 0;
+        }
+    }
+    return -ENOMEM;
+}
+
+static void _local_mod_pub_set(struct bt_mesh_model *model,
+                               const struct bt_mesh_cfg_mod_pub *pub)
+{
+    model->pub->addr = pub->addr;
+    model->pub->key = pub->app_idx;
+    model->pub->cred = 0;
+    model->pub->ttl = pub->ttl;
+    model->pub->retransmit = pub->transmit;
+    model->pub->period = 0;
+}
+
 static void _prov_base(void)
 {
+    uint32_t t_start = xtimer_now_usec();
+
     puts("Provisioning the base device:");
     /* generate node address and device key */
     luid_get(_key_dev, 16);
@@ -303,22 +649,138 @@ static void _prov_base(void)
                                 PROV_IV_INDEX, _addr_node, _key_dev);
     assert(res == 0);
     /* add our app key to the node */
-    res = bt_mesh_cfg_app_key_add(PROV_NET_IDX, _addr_node, PROV_NET_IDX,
-                                  PROV_APP_IDX, _key_app, NULL);
+    res = _local_app_key_add(PROV_NET_IDX, PROV_APP_IDX, _key_app);
     assert(res == 0);
+    (void)res;
 
     puts("Base provisioning done\n");
+    _print_ready("base", t_start);
+}
+
+/* publish scheduler: deadlines are absolute (start + n * itvl + offset), so
+ * the time spent publishing does not accumulate. In slot mode, each node
+ * publishes in its own slot of the interval. Slot indices are assigned by the
+ * experiment script, node addresses are random and would collide. */
+enum {
+    SCHED_MODE_JITTER,
+    SCHED_MODE_SLOT,
+};
+
+typedef struct {
+    xtimer_ticks32_t last;      /* absolute time of the current deadline */
+    uint32_t t_first;           /* time of the first wakeup [us] */
+    uint32_t t_prev;            /* time of the previous wakeup [us] */
+    uint32_t itvl;              /* nominal interval [us] */
+    uint32_t jttr;              /* max jitter added to each deadline [us] */
+    uint32_t offset;            /* offset of the current deadline [us] */
+    uint32_t offset_first;      /* offset of the first deadline [us] */
+    unsigned round;
+    uint32_t late_sum;
+    uint32_t late_max;
+    uint32_t err_max;           /* max deviation of an achieved interval */
+} pubsched_t;
+
+static unsigned _sched_mode = SCHED_MODE_JITTER;
+static unsigned _sched_slots = EXP_SLOTS;
+static unsigned _sched_slot = 0;
+
+static uint32_t _sched_offset(const pubsched_t *s)
+{
+    uint32_t base = 0;
+    uint32_t jttr = s->jttr;
+
+    if (_sched_mode == SCHED_MODE_SLOT) {
+        uint32_t width = s->itvl / _sched_slots;
+        base = _sched_slot * width;
+        /* keep the jitter inside the first half of our own slot */
+        if (jttr > (width / 2)) {
+            jttr = width / 2;
+        }
+    }
+    return base + ((jttr > 0) ? random_uint32_range(0, jttr) : 0);
 }
 
-static void _prov_source(void)
+static void _sched_init(pubsched_t *s, uint32_t itvl, uint32_t jttr)
+{
+    memset(s, 0, sizeof(*s));
+    s->itvl = itvl;
+    s->jttr = jttr;
+    s->last = xtimer_now();
+}
+
+static void _sched_wait(pubsched_t *s)
+{
+    uint32_t offset = _sched_offset(s);
+    uint32_t delta = (s->round == 0) ? offset
+                                     : (s->itvl + offset - s->offset);
+
+    if (delta > 0) {
+        xtimer_periodic_wakeup(&s->last, delta);
+    }
+
+    uint32_t now = xtimer_now_usec();
+    uint32_t late = now - xtimer_usec_from_ticks(s->last);
+    s->late_sum += late;
+    if (late > s->late_max) {
+        s->late_max = late;
+    }
+    if (s->round == 0) {
+        s->t_first = now;
+        s->offset_first = offset;
+    }
+    else {
+        uint32_t achieved = now - s->t_prev;
+        uint32_t err = (achieved > delta) ? (achieved - delta)
+                                          : (delta - achieved);
+        if (err > s->err_max) {
+            s->err_max = err;
+        }
+    }
+
+    s->t_prev = now;
+    s->offset = offset;
+    s->round++;
+}
+
+static void _sched_report(const pubsched_t *s)
+{
+    /* time between first and last deadline vs. the time actually spent */
+    int32_t nominal = 0;
+    if (s->round > 0) {
+        nominal = (int32_t)((s->round - 1) * s->itvl)
+                  + (int32_t)s->offset - (int32_t)s->offset_first;
+    }
+    int32_t span = (int32_t)(s->t_prev - s->t_first);
+
+    printf("sched: mode %s, %u rounds, itvl %lu us, jitter %lu us\n",
+           (_sched_mode == SCHED_MODE_SLOT) ? "slot" : "jitter",
+           s->round, (unsigned long)s->itvl, (unsigned long)s->jttr);
+    printf("sched: late avg %lu us, late max %lu us, itvl err max %lu us\n",
+           (unsigned long)((s->round > 0) ? (s->late_sum / s->round) : 0),
+           (unsigned long)s->late_max, (unsigned long)s->err_max);
+    printf("sched: span %li us, nominal %li us, drift %li us\n",
+           (long)span, (long)nominal, (long)(span - nominal));
+}
+
+static int _groups_valid(unsigned groups, unsigned max)
+{
+    if ((groups == 0) || (groups > max)) {
+        printf("err: number of groups must be in [1, %u]\n", max);
+        return 0;
+    }
+    return 1;
+}
+
+static void _prov_source(unsigned groups)
 {
     int res;
+    uint32_t t_start = xtimer_now_usec();
 
     struct bt_mesh_cfg_mod_pub pub = {
         .addr = PROV_ADDR_GROUP0,
         .app_idx = PROV_APP_IDX,
-        .ttl = 15,
-        .transmit = 0,
+        .ttl = PROV_PUB_TTL,
+        .transmit = PROV_PUB_TRANSMIT,
     };
 
     puts("Provisioning the SOURCE element:");
@@ -338,15 +800,29 @@ static void _prov_source(void)
                                   BT_MESH_MODEL_ID_GEN_LEVEL_CLI,
                                   &pub, NULL);
     assert(res == 0);
-    puts("SOURCE element provisioned");
+    res = bt_mesh_cfg_mod_app_bind_vnd(PROV_NET_IDX, _addr_node, ADDR_CLIENT,
+                                       PROV_APP_IDX, VND_MODEL_ID_AGG_CLI,
+                                       VENDOR_CID, NULL);
+    assert(res == 0);
+    res = bt_mesh_cfg_mod_pub_set_vnd(PROV_NET_IDX, _addr_node, ADDR_CLIENT,
+                                      VND_MODEL_ID_AGG_CLI, VENDOR_CID,
+                                      &pub, NULL);
+    assert(res == 0);
+    (void)res;
+    _group_base = PROV_ADDR_GROUP0;
+    _pub_groups = groups;
+    _pub_group_next = 0;
+    printf("SOURCE element provisioned (%u groups)\n", groups);
+    _print_ready("source", t_start);
 
     mystats_clear();
     mystats_enable();
 }
 
-static void _prov_sink(void)
+static void _prov_sink(unsigned groups)
 {
     int res;
+    uint32_t t_start = xtimer_now_usec();
 
     puts("Provisioning the SINK element:");
     res = bt_mesh_cfg_mod_app_bind(PROV_NET_IDX, _addr_node, ADDR_SERVER,
@@ -357,18 +833,444 @@ static void _prov_sink(void)
                                    PROV_APP_IDX,
                                    BT_MESH_MODEL_ID_GEN_LEVEL_SRV, NULL);
     assert(res == 0);
-    res = bt_mesh_cfg_mod_sub_add(PROV_NET_IDX, _addr_node, ADDR_SERVER,
-                                  PROV_ADDR_GROUP0,
-                                  BT_MESH_MODEL_ID_GEN_ONOFF_SRV, NULL);
+    res = bt_mesh_cfg_mod_app_bind_vnd(PROV_NET_IDX, _addr_node, ADDR_SERVER,
+                                       PROV_APP_IDX, VND_MODEL_ID_AGG_SRV,
+                                       VENDOR_CID, NULL);
     assert(res == 0);
-    res = bt_mesh_cfg_mod_sub_add(PROV_NET_IDX, _addr_node, ADDR_SERVER,
-                                  PROV_ADDR_GROUP0,
-                                  BT_MESH_MODEL_ID_GEN_LEVEL_SRV, NULL);
-    assert(res == 0);
-    puts("SINK element provisioned");
+    for (unsigned i = 0; i < groups; i++) {
+        res = bt_mesh_cfg_mod_sub_add(PROV_NET_IDX, _addr_node, ADDR_SERVER,
+                                      (PROV_ADDR_GROUP0 + i),
+                                      BT_MESH_MODEL_ID_GEN_ONOFF_SRV, NULL);
+        assert(res == 0);
+        res = bt_mesh_cfg_mod_sub_add(PROV_NET_IDX, _addr_node, ADDR_SERVER,
+                                      (PROV_ADDR_GROUP0 + i),
+                                      BT_MESH_MODEL_ID_GEN_LEVEL_SRV, NULL);
+        assert(res == 0);
+        res = bt_mesh_cfg_mod_sub_add_vnd(PROV_NET_IDX, _addr_node,
+                                          ADDR_SERVER, (PROV_ADDR_GROUP0 + i),
+                                          VND_MODEL_ID_AGG_SRV, VENDOR_CID,
+                                          NULL);
+        assert(res == 0);
+    }
+    (void)res;
+    _group_base = PROV_ADDR_GROUP0;
+    printf("SINK element provisioned (%u groups)\n", groups);
+    _print_ready("sink", t_start);
+
+    mystats_clear();
+    mystats_enable();
+}
+
+static int _local_source(struct bt_mesh_model *models, size_t cnt,
+                         const struct bt_mesh_cfg_mod_pub *pub)
+{
+    for (unsigned i = 0; i < cnt; i++) {
+        int res = _local_mod_bind(&models[i], PROV_APP_IDX);
+        if (res != 0) {
+            return res;
+        }
+        _local_mod_pub_set(&models[i], pub);
+    }
+    return 0;
+}
+
+static int _local_sink(struct bt_mesh_model *models, size_t cnt,
+                       uint16_t group, unsigned groups)
+{
+    for (unsigned i = 0; i < cnt; i++) {
+        int res = _local_mod_bind(&models[i], PROV_APP_IDX);
+        if (res != 0) {
+            return res;
+        }
+        for (unsigned g = 0; g < groups; g++) {
+            res = _local_mod_sub_add(&models[i], (group + g));
+            if (res != 0) {
+                return res;
+            }
+        }
+    }
+    return 0;
+}
+
+static int _prov_direct(const uint8_t *blob, size_t len)
+{
+    int res;
+    uint32_t t_start = xtimer_now_usec();
+
+    if ((len != PROV_BLOB_HDR_LEN) && (len != PROV_BLOB_MAX_LEN)) {
+        return -EINVAL;
+    }
+
+    uint8_t role = blob[0];
+    unsigned groups = blob[3];
+    if ((role == 0) || (role & ~(PROV_ROLE_SOURCE | PROV_ROLE_SINK))) {
+        return -EINVAL;
+    }
+    struct bt_mesh_cfg_mod_pub pub = {
+        .addr = (uint16_t)(blob[1] | (blob[2] << 8)),
+        .app_idx = PROV_APP_IDX,
+        .ttl = blob[4],
+        .transmit = blob[5],
+    };
+
+    /* sinks are limited by the models' subscription lists, check this up
+     * front so a failure does not leave a partial subscription behind */
+    unsigned max = (role & PROV_ROLE_SINK) ? ARRAY_SIZE(_models_svr[0].groups)
+                                           : PROV_GROUPS_MAX;
+    if (!BT_MESH_ADDR_IS_GROUP(pub.addr) ||
+        !BT_MESH_ADDR_IS_GROUP(pub.addr + groups - 1) ||
+        !_groups_valid(groups, max)) {
+        return -EINVAL;
+    }
+
+    if (len == PROV_BLOB_MAX_LEN) {
+        res = _local_app_key_add(PROV_NET_IDX, PROV_APP_IDX,
+                                 &blob[PROV_BLOB_HDR_LEN]);
+        if (res != 0) {
+            return res;
+        }
+    }
+
+    if (role & PROV_ROLE_SOURCE) {
+        res = _local_source(_models_cli, ARRAY_SIZE(_models_cli), &pub);
+        if (res == 0) {
+            res = _local_source(_models_cli_vnd, ARRAY_SIZE(_models_cli_vnd),
+                                &pub);
+        }
+        if (res != 0) {
+            return res;
+        }
+    }
+    if (role & PROV_ROLE_SINK) {
+        res = _local_sink(_models_svr, ARRAY_SIZE(_models_svr),
+                          pub.addr, groups);
+        if (res == 0) {
+            res = _local_sink(_models_svr_vnd, ARRAY_SIZE(_models_svr_vnd),
+                              pub.addr, groups);
+        }
+        if (res != 0) {
+            return res;
+        }
+    }
+
+    _group_base = pub.addr;
+    _pub_groups = groups;
+    _pub_group_next = 0;
+
+    printf("Direct provisioning done (role 0x%02x, group 0x%04x, %u groups)\n",
+           (int)role, (int)pub.addr, groups);
+    _print_ready("prov", t_start);
 
     mystats_clear();
     mystats_enable();
+    return 0;
+}
+
+static void _group_stats_clear(void)
+{
+    memset(_rx_group, 0, sizeof(_rx_group));
+    _rx_other = 0;
+    _tx_agg_msgs = 0;
+    _rx_agg_msgs = 0;
+    _rx_readings = 0;
+}
+
+static void _group_stats_dump(void)
+{
+    for (unsigned i = 0; i < PROV_GROUPS_MAX; i++) {
+        if (_rx_group[i] > 0) {
+            printf("rx group 0x%04x: %u\n", (int)(_group_base + i),
+                   _rx_group[i]);
+        }
+    }
+    printf("rx group other: %u\n", _rx_other);
+    printf("tx agg msgs: %u\n", _tx_agg_msgs);
+    printf("rx agg msgs: %u\n", _rx_agg_msgs);
+    printf("rx agg readings: %u\n", _rx_readings);
+}
+
+extern int __real_bt_mesh_net_send(struct bt_mesh_net_tx *tx,
+                                   struct os_mbuf *buf,
+                                   const struct bt_mesh_send_cb *cb,
+                                   void *cb_data);
+extern int __real_bt_mesh_net_resend(struct bt_mesh_subnet *sub,
+                                     struct os_mbuf *buf, bool new_key,
+                                     const struct bt_mesh_send_cb *cb,
+                                     void *cb_data);
+extern int __real_bt_mesh_trans_recv(struct os_mbuf *buf,
+                                     struct bt_mesh_net_rx *rx);
+
+int __wrap_bt_mesh_net_send(struct bt_mesh_net_tx *tx, struct os_mbuf *buf,
+                            const struct bt_mesh_send_cb *cb, void *cb_data)
+{
+    /* buf holds the lower transport PDU, the network header is added later */
+    uint8_t hdr = buf->om_data[0];
+    if (tx->ctx->app_idx == BT_MESH_KEY_UNUSED) {
+        if (!(hdr & LTP_SEG) && ((hdr & LTP_CTL_OP_MASK) == LTP_CTL_OP_ACK)) {
+            _ltp.tx_acks++;
+        }
+    }
+    if (hdr & LTP_SEG) {
+        _ltp.tx_segs++;
+    }
+    _air_origin[thread_getpid()] = true;
+    int res = __real_bt_mesh_net_send(tx, buf, cb, cb_data);
+    _air_origin[thread_getpid()] = false;
+    return res;
+}
+
+int __wrap_bt_mesh_net_resend(struct bt_mesh_subnet *sub,
+                              struct os_mbuf *buf, bool new_key,
+                              const struct bt_mesh_send_cb *cb, void *cb_data)
+{
+    /* the lower transport only resends unacknowledged segments */
+    _ltp.tx_retrans++;
+    _air_origin[thread_getpid()] = true;
+    int res = __real_bt_mesh_net_resend(sub, buf, new_key, cb, cb_data);
+    _air_origin[thread_getpid()] = false;
+    return res;
+}
+
+extern void __real_bt_mesh_adv_send(struct os_mbuf *buf,
+                                    const struct bt_mesh_send_cb *cb,
+                                    void *cb_data);
+
+void __wrap_bt_mesh_adv_send(struct os_mbuf *buf,
+                             const struct bt_mesh_send_cb *cb, void *cb_data)
+{
+    unsigned events = BT_MESH_TRANSMIT_COUNT(BT_MESH_ADV(buf)->xmit) + 1;
+    unsigned frames = events * AIR_ADV_CHANNELS;
+    unsigned bytes = buf->om_len + AIR_ADV_OVERHEAD;
+    air_cnt_t *air = &_air[_air_origin[thread_getpid()] ? AIR_ORIGIN
+                                                        : AIR_RELAY];
+
+    unsigned state = irq_disable();
+    air->events += events;
+    air->frames += frames;
+    air->bytes += frames * bytes;
+    air->us += frames * bytes * AIR_US_PER_BYTE;
+    irq_restore(state);
+
+    __real_bt_mesh_adv_send(buf, cb, cb_data);
+}
+
+static void _ltp_rx_seg(uint16_t src, const uint8_t *ltp)
+{
+    uint16_t seq_zero = (uint16_t)(((ltp[1] & 0x7f) << 6) | (ltp[2] >> 2));
+    uint32_t id = ((uint32_t)src << 16) | seq_zero;
+
+    _ltp.rx_segs++;
+    for (unsigned i = 0; i < SEG_RX_TRACK; i++) {
+        if (_ltp_rx_track[i] == id) {
+            return;
+        }
+    }
+    _ltp_rx_track[_ltp_rx_track_next] = id;
+    _ltp_rx_track_next = (_ltp_rx_track_next + 1) % SEG_RX_TRACK;
+    _ltp.rx_msgs++;
+}
+
+int __wrap_bt_mesh_trans_recv(struct os_mbuf *buf, struct bt_mesh_net_rx *rx)
+{
+    /* the network header is still in front of the lower transport PDU */
+    if (rx->local_match && (buf->om_len > (BT_MESH_NET_HDR_LEN + 3))) {
+        const uint8_t *ltp = &buf->om_data[BT_MESH_NET_HDR_LEN];
+        if (!rx->ctl && (ltp[0] & LTP_SEG)) {
+            _ltp_rx_seg(rx->ctx.addr, ltp);
+        }
+        else if (rx->ctl && ((ltp[0] & LTP_CTL_OP_MASK) == LTP_CTL_OP_ACK)) {
+            _ltp.rx_acks++;
+        }
+    }
+    return __real_bt_mesh_trans_recv(buf, rx);
+}
+
+static void _seg_stats_clear(void)
+{
+    unsigned state = irq_disable();
+    memset(&_ltp, 0, sizeof(_ltp));
+    memset(_ltp_rx_track, 0, sizeof(_ltp_rx_track));
+    _ltp_rx_track_next = 0;
+    _seg_tx_msgs = 0;
+    _seg_tx_done = 0;
+    _seg_tx_fail = 0;
+    _seg_tx_bytes = 0;
+    _seg_lat_sum = 0;
+    _seg_lat_min = UINT32_MAX;
+    _seg_lat_max = 0;
+    _seg_rx_msgs = 0;
+    _seg_rx_corrupt = 0;
+    _seg_rx_bytes = 0;
+    irq_restore(state);
+}
+
+static unsigned long _goodput(uint32_t bytes, uint32_t t_first, uint32_t t_last)
+{
+    uint32_t dur = t_last - t_first;
+    if (dur == 0) {
+        return 0;
+    }
+    return (unsigned long)(((uint64_t)bytes * 8 * US_PER_SEC) / dur);
+}
+
+static void _seg_stats_dump(void)
+{
+    printf("ltp tx segs: %u\n", _ltp.tx_segs);
+    printf("ltp tx seg retransmissions: %u\n", _ltp.tx_retrans);
+    printf("ltp tx acks: %u\n", _ltp.tx_acks);
+    printf("ltp rx segs: %u\n", _ltp.rx_segs);
+    printf("ltp rx acks: %u\n", _ltp.rx_acks);
+    printf("ltp rx seg msgs: %u\n", _ltp.rx_msgs);
+    printf("ltp rx seg incomplete: %u\n", (_ltp.rx_msgs > _ltp.rx_done) ?
+           (_ltp.rx_msgs - _ltp.rx_done) : 0);
+
+    if (_seg_tx_msgs > 0) {
+        printf("seg tx msgs: %u\n", _seg_tx_msgs);
+        printf("seg tx done: %u\n", _seg_tx_done);
+        printf("seg tx failed: %u\n", _seg_tx_fail);
+    }
+    if (_seg_tx_done > 0) {
+        printf("seg tx latency avg: %lu\n",
+               (unsigned long)(_seg_lat_sum / _seg_tx_done));
+        printf("seg tx latency min: %lu\n", (unsigned long)_seg_lat_min);
+        printf("seg tx latency max: %lu\n", (unsigned long)_seg_lat_max);
+        printf("seg tx goodput bps: %lu\n",
+               _goodput(_seg_tx_bytes, _seg_t_first, _seg_t_last));
+    }
+    if ((_seg_rx_msgs > 0) || (_seg_rx_corrupt > 0)) {
+        printf("seg rx msgs: %u\n", _seg_rx_msgs);
+        printf("seg rx corrupt: %u\n", _seg_rx_corrupt);
+        printf("seg rx bytes: %lu\n", (unsigned long)_seg_rx_bytes);
+        printf("seg rx goodput bps: %lu\n",
+               _goodput(_seg_rx_bytes, _seg_rx_t_first, _seg_rx_t_last));
+    }
+}
+
+static void _air_clear(void)
+{
+    unsigned state = irq_disable();
+    memset(_air, 0, sizeof(_air));
+    irq_restore(state);
+}
+
+static int _cmd_airtime(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    uint32_t total = 0;
+    unsigned rx = _rx_other;
+
+    for (unsigned i = 0; i < AIR_NUMOF; i++) {
+        printf("air %s events: %u\n", _air_names[i], _air[i].events);
+        printf("air %s frames: %u\n", _air_names[i], _air[i].frames);
+        printf("air %s bytes: %lu\n", _air_names[i],
+               (unsigned long)_air[i].bytes);
+        printf("air %s us: %lu\n", _air_names[i], (unsigned long)_air[i].us);
+        total += _air[i].us;
+    }
+    printf("air total us: %lu\n", (unsigned long)total);
+
+    /* messages delivered to this node's models; across the network, divide
+     * the sum of all nodes' airtime by the sum of all sinks' deliveries */
+    for (unsigned i = 0; i < PROV_GROUPS_MAX; i++) {
+        rx += _rx_group[i];
+    }
+    printf("app rx msgs: %u\n", rx);
+    if (rx > 0) {
+        printf("air us per rx msg: %lu\n", (unsigned long)(total / rx));
+    }
+    /* an aggregate message delivers all of its readings at once */
+    unsigned readings = rx - _rx_agg_msgs + _rx_readings;
+    printf("app rx readings: %u\n", readings);
+    if (readings > 0) {
+        printf("air us per rx reading: %lu\n",
+               (unsigned long)(total / readings));
+    }
+
+    return 0;
+}
+
+static const char *_thread_name(kernel_pid_t pid)
+{
+#ifdef DEVELHELP
+    return thread_getname(pid);
+#else
+    (void)pid;
+    return "-";
+#endif
+}
+
+static void _cpu_reset(void)
+{
+    unsigned state = irq_disable();
+    for (kernel_pid_t pid = KERNEL_PID_FIRST; pid <= KERNEL_PID_LAST; pid++) {
+        _cpu_ticks[pid] = sched_pidlist[pid].runtime_ticks;
+    }
+    _cpu_t_start = xtimer_now64().ticks64;
+    irq_restore(state);
+}
+
+static int _cmd_mem(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+
+#ifdef DEVELHELP
+    for (kernel_pid_t pid = KERNEL_PID_FIRST; pid <= KERNEL_PID_LAST; pid++) {
+        thread_t *t = (thread_t *)sched_threads[pid];
+        if (t == NULL) {
+            continue;
+        }
+        int unused = thread_measure_stack_free(t->stack_start);
+        printf("stack %s: used max %i of %i\n", _thread_name(pid),
+               t->stack_size - unused, t->stack_size);
+    }
+#endif
+
+    /* all mbufs (advertising and segmentation buffers included) and the
+     * host's internal state come from these pools */
+    struct os_mempool *mp = NULL;
+    struct os_mempool_info omi;
+    while ((mp = os_mempool_info_get_next(mp, &omi)) != NULL) {
+        printf("pool %s: %i of %i free, min free %i, block size %i\n",
+               omi.omi_name, omi.omi_num_free, omi.omi_num_blocks,
+               omi.omi_min_free, omi.omi_block_size);
+    }
+
+    return 0;
+}
+
+static int _cmd_cpu(int argc, char **argv)
+{
+    if ((argc >= 2) && (strcmp(argv[1], "reset") == 0)) {
+        _cpu_reset();
+        return 0;
+    }
+
+    uint64_t busy[KERNEL_PID_LAST + 1];
+    unsigned state = irq_disable();
+    uint64_t window = xtimer_now64().ticks64 - _cpu_t_start;
+    for (kernel_pid_t pid = KERNEL_PID_FIRST; pid <= KERNEL_PID_LAST; pid++) {
+        uint64_t now = sched_pidlist[pid].runtime_ticks;
+        busy[pid] = (now >= _cpu_ticks[pid]) ? (now - _cpu_ticks[pid]) : now;
+    }
+    irq_restore(state);
+
+    printf("cpu window: %lu ms\n",
+           (unsigned long)(xtimer_usec_from_ticks64(window) / US_PER_MS));
+    if (window == 0) {
+        return 0;
+    }
+    for (kernel_pid_t pid = KERNEL_PID_FIRST; pid <= KERNEL_PID_LAST; pid++) {
+        if (sched_threads[pid] == NULL) {
+            continue;
+        }
+        unsigned permille = (unsigned)((busy[pid] * 1000) / window);
+        printf("cpu %s: %u.%u%%\n", _thread_name(pid),
+               permille / 10, permille % 10);
+    }
+
+    return 0;
 }
 
 static int _cmd_clear(int argc, char **argv)
@@ -376,6 +1278,10 @@ static int _cmd_clear(int argc, char **argv)
     (void)argc;
     (void)argv;
     mystats_clear();
+    _group_stats_clear();
+    _seg_stats_clear();
+    _air_clear();
+    _cpu_reset();
     return 0;
 }
 
@@ -384,22 +1290,60 @@ static int _cmd_stats(int argc, char **argv)
     (void)argc;
     (void)argv;
     mystats_dump();
+    _group_stats_dump();
+    _seg_stats_dump();
     return 0;
 }
 
 static int _cmd_cfg_source(int argc, char **argv)
 {
-    (void)argc;
-    (void)argv;
-    _prov_source();
+    unsigned groups = 1;
+
+    if (argc >= 2) {
+        groups = (unsigned)atoi(argv[1]);
+    }
+    if (!_groups_valid(groups, PROV_GROUPS_MAX)) {
+        return 1;
+    }
+
+    _prov_source(groups);
     return 0;
 }
 
 static int _cmd_cfg_sink(int argc, char **argv)
 {
-    (void)argc;
-    (void)argv;
-    _prov_sink();
+    unsigned groups = 1;
+
+    if (argc >= 2) {
+        groups = (unsigned)atoi(argv[1]);
+    }
+    if (!_groups_valid(groups, ARRAY_SIZE(_models_svr[0].groups))) {
+        return 1;
+    }
+
+    _prov_sink(groups);
+    return 0;
+}
+
+static int _cmd_prov(int argc, char **argv)
+{
+    uint8_t blob[PROV_BLOB_MAX_LEN];
+
+    if (argc < 2) {
+        printf("usage: %s <hex blob>\n", argv[0]);
+        return 1;
+    }
+    if (fmt_strlen(argv[1]) > (2 * sizeof(blob))) {
+        puts("err: provisioning blob too long");
+        return 1;
+    }
+
+    size_t len = fmt_hex_bytes(blob, argv[1]);
+    int res = _prov_direct(blob, len);
+    if (res != 0) {
+        printf("err: direct provisioning failed (%i)\n", res);
+        return 1;
+    }
     return 0;
 }
 
@@ -417,9 +1361,42 @@ static int _cmd_wl(int argc, char **argv)
     return 0;
 }
 
+static int _cmd_sched(int argc, char **argv)
+{
+    if (argc >= 2) {
+        if (strcmp(argv[1], "jitter") == 0) {
+            _sched_mode = SCHED_MODE_JITTER;
+        }
+        else if ((strcmp(argv[1], "slot") == 0) && (argc >= 4)) {
+            unsigned slots = (unsigned)atoi(argv[2]);
+            unsigned slot = (unsigned)atoi(argv[3]);
+            if ((slots == 0) || (slot >= slots)) {
+                puts("err: slot index must be in [0, num slots - 1]");
+                return 1;
+            }
+            _sched_mode = SCHED_MODE_SLOT;
+            _sched_slots = slots;
+            _sched_slot = slot;
+        }
+        else {
+            printf("usage: %s [jitter|slot <num slots> <slot idx>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (_sched_mode == SCHED_MODE_SLOT) {
+        printf("sched: slot mode, slot %u of %u\n", _sched_slot, _sched_slots);
+    }
+    else {
+        puts("sched: jitter mode");
+    }
+    return 0;
+}
+
 static int _cmd_run(int argc, char **argv)
 {
     uint32_t itvl = EXP_INTERVAL;
+    uint32_t jttr = 0;
     unsigned cnt = EXP_REPEAT;
     struct bt_mesh_model *model = &_models_cli[0];
 
@@ -434,14 +1411,26 @@ static int _cmd_run(int argc, char **argv)
     if (argc >= 3) {
         itvl = (uint32_t)atoi(argv[2]);
     }
+    if (argc >= 4) {
+        jttr = (uint32_t)atoi(argv[3]);
+    }
+    if (jttr >= itvl) {
+        puts("err: jitter must be smaller than the interval");
+        return 1;
+    }
 
-    xtimer_ticks32_t last_wakeup = xtimer_now();
+    pubsched_t sched;
+    _sched_init(&sched, itvl, jttr);
+    _cpu_reset();
     _trans_id = 0;  /* reset, this way we can trace the experiment */
+    _pub_group_next = 0;
 
     for (unsigned i = 0; i < cnt; i++) {
         // printf("publishing event %u\n", i);
+        _sched_wait(&sched);
 
-        mystats_inc_tx_app("pub", _trans_id);
+        mystats_inc_tx_app("pub", APP_VAL(ADDR_CLIENT, _trans_id));
+        model->pub->addr = _pub_group_get();
         bt_mesh_model_msg_init(model->pub->msg, OP_SET_UNACK);
         net_buf_simple_add_u8(model->pub->msg, 0);
         net_buf_simple_add_u8(model->pub->msg, _trans_id++);
@@ -460,10 +1449,9 @@ static int _cmd_run(int argc, char **argv)
             uint8_t st = bt_mesh_relay_get();
             printf("RELAY RETRANSMIT STATE: 0x%02x -> cnt %i, int: %i\n",
                     (int)st, (int)(relay >> 5), (int)(relay & 0x1f));
-
-        xtimer_periodic_wakeup(&last_wakeup, itvl);
     }
 
+    _sched_report(&sched);
     puts("EXP DONE");
 
     return 0;
@@ -491,24 +1479,244 @@ static int _cmd_run_lvl(int argc, char **argv)
         jttr = (uint32_t)atoi(argv[3]);
     }
 
-    uint32_t min = itvl - jttr;
-    uint32_t max = itvl + jttr;
-    assert(min < max);
+    if (jttr >= itvl) {
+        puts("err: jitter must be smaller than the interval");
+        return 1;
+    }
 
+    pubsched_t sched;
+    _sched_init(&sched, itvl, jttr);
+    _cpu_reset();
     _trans_id = 0;  /* reset, this way we can trace the experiment */
+    _pub_group_next = 0;
 
     for (unsigned i = 0; i < cnt; i++) {
-        mystats_inc_tx_app("pub_lvl", (_trans_id + _addr_node));
+        _sched_wait(&sched);
+        mystats_inc_tx_app("pub_lvl",
+                           APP_VAL(ADDR_CLIENT, _trans_id + _addr_node));
+        model->pub->addr = _pub_group_get();
         bt_mesh_model_msg_init(model->pub->msg, OP_LVL_SET_UNACK);
         net_buf_simple_add_le16(model->pub->msg, (_trans_id + _addr_node));
         net_buf_simple_add_u8(model->pub->msg, _trans_id++);
         int res = bt_mesh_model_publish(model);
         assert(res == 0);
         (void)res;
+    }
+
+    _sched_report(&sched);
+    puts("EXP DONE");
+
+    return 0;
+}
+
+static void _agg_publish(struct bt_mesh_model *model, unsigned readings)
+{
+    if (readings == 0) {
+        return;
+    }
+    _tx_agg_msgs++;
+    int res = bt_mesh_model_publish(model);
+    assert(res == 0);
+    (void)res;
+}
+
+static int _cmd_run_agg(int argc, char **argv)
+{
+    uint32_t itvl = EXP_INTERVAL;
+    uint32_t jttr = EXP_JITTER;
+    unsigned cnt = EXP_REPEAT;
+    unsigned batch = AGG_UNSEG_MAX;
+    struct bt_mesh_model *model = &_models_cli_vnd[0];
+
+    if (!_is_provisioned || (model->pub->addr == BT_MESH_ADDR_UNASSIGNED)) {
+        puts("err: node or element not provisioned");
+        return 1;
+    }
+
+    if (argc >= 2) {
+        cnt = (unsigned)atoi(argv[1]);
+    }
+    if (argc >= 3) {
+        itvl = (uint32_t)atoi(argv[2]);
+    }
+    if (argc >= 4) {
+        jttr = (uint32_t)atoi(argv[3]);
+    }
+    if (argc >= 5) {
+        batch = (unsigned)atoi(argv[4]);
+    }
+    if (jttr >= itvl) {
+        puts("err: jitter must be smaller than the interval");
+        return 1;
+    }
+    if ((batch == 0) || (batch > AGG_BATCH_MAX)) {
+        printf("err: batch size must be in [1, %u]\n", (unsigned)AGG_BATCH_MAX);
+        return 1;
+    }
+    if (batch > AGG_UNSEG_MAX) {
+        printf("note: batches of more than %u readings are segmented\n",
+               (unsigned)AGG_UNSEG_MAX);
+    }
+
+    /* readings are taken on the publish schedule, a message is published
+     * once the batch is full */
+    pubsched_t sched;
+    _sched_init(&sched, itvl, jttr);
+    _cpu_reset();
+    _trans_id = 0;  /* reset, this way we can trace the experiment */
+    _pub_group_next = 0;
+    unsigned pending = 0;
+
+    for (unsigned i = 0; i < cnt; i++) {
+        _sched_wait(&sched);
+        if (pending == 0) {
+            model->pub->addr = _pub_group_get();
+            bt_mesh_model_msg_init(model->pub->msg, OP_VND_AGG);
+            net_buf_simple_add_le16(model->pub->msg, _addr_node);
+        }
+        mystats_inc_tx_app("agg_rd",
+                           APP_VAL(_addr_node, _trans_id + _addr_node));
+        net_buf_simple_add_u8(model->pub->msg, _trans_id);
+        net_buf_simple_add_le16(model->pub->msg, (_trans_id + _addr_node));
+        _trans_id++;
+        if (++pending == batch) {
+            _agg_publish(model, pending);
+            pending = 0;
+        }
+    }
+    _agg_publish(model, pending);
+
+    _sched_report(&sched);
+    puts("EXP DONE");
 
-        xtimer_usleep(random_uint32_range(min, max));
+    return 0;
+}
+
+static void _seg_sent(int err, void *cb_data)
+{
+    uint32_t now = xtimer_now_usec();
+    unsigned size = (unsigned)(uintptr_t)cb_data;
+
+    /* unicast messages end once all segments are acknowledged, group
+     * messages once all segment transmissions are done */
+    if (err == 0) {
+        uint32_t lat = now - _seg_t_start;
+        _seg_tx_done++;
+        _seg_tx_bytes += size;
+        _seg_lat_sum += lat;
+        _seg_lat_min = (lat < _seg_lat_min) ? lat : _seg_lat_min;
+        _seg_lat_max = (lat > _seg_lat_max) ? lat : _seg_lat_max;
+        _seg_t_last = now;
+    }
+    else {
+        _seg_tx_fail++;
+    }
+    mutex_unlock(&_seg_lock);
+}
+
+static const struct bt_mesh_send_cb _seg_send_cb = {
+    .start = NULL,
+    .end = _seg_sent,
+};
+
+static int _seg_send(struct bt_mesh_model *model, uint16_t dst, unsigned size,
+                     uint16_t seq)
+{
+    struct bt_mesh_msg_ctx ctx = {
+        .net_idx = PROV_NET_IDX,
+        .app_idx = PROV_APP_IDX,
+        .addr = dst,
+        .send_ttl = model->pub->ttl,
+    };
+    struct os_mbuf *msg = NET_BUF_SIMPLE(3 + SEG_SIZE_MAX + SEG_MIC_LEN);
+
+    bt_mesh_model_msg_init(msg, OP_VND_SEG);
+    net_buf_simple_add_le16(msg, _addr_node);
+    net_buf_simple_add_le16(msg, seq);
+    for (unsigned i = 0; i < (size - SEG_HDR_LEN); i++) {
+        net_buf_simple_add_u8(msg, (uint8_t)(seq + i));
+    }
+
+    mystats_inc_tx_app("seg", APP_VAL(_addr_node, seq));
+    _seg_t_start = xtimer_now_usec();
+    if (_seg_tx_msgs++ == 0) {
+        _seg_t_first = _seg_t_start;
+    }
+    int res = bt_mesh_model_send(model, &ctx, msg, &_seg_send_cb,
+                                 (void *)(uintptr_t)size);
+    os_mbuf_free_chain(msg);
+    return res;
+}
+
+static int _cmd_run_seg(int argc, char **argv)
+{
+    uint32_t itvl = EXP_INTERVAL;
+    unsigned cnt = EXP_REPEAT;
+    unsigned size = SEG_SIZE_MAX;
+    struct bt_mesh_model *model = &_models_cli_vnd[0];
+    uint16_t dst = BT_MESH_ADDR_UNASSIGNED;
+
+    if (!_is_provisioned || (model->pub->addr == BT_MESH_ADDR_UNASSIGNED)) {
+        puts("err: node or element not provisioned");
+        return 1;
     }
 
+    if (argc >= 2) {
+        cnt = (unsigned)atoi(argv[1]);
+    }
+    if (argc >= 3) {
+        itvl = (uint32_t)atoi(argv[2]);
+    }
+    if (argc >= 4) {
+        size = (unsigned)atoi(argv[3]);
+    }
+    if (argc >= 5) {
+        dst = (uint16_t)strtoul(argv[4], NULL, 0);
+        if (!BT_MESH_ADDR_IS_UNICAST(dst) && !BT_MESH_ADDR_IS_GROUP(dst)) {
+            puts("err: destination must be a unicast or group address");
+            return 1;
+        }
+    }
+    if ((size < SEG_HDR_LEN) || (size > SEG_SIZE_MAX)) {
+        printf("err: size must be in [%u, %u]\n",
+               (unsigned)SEG_HDR_LEN, (unsigned)SEG_SIZE_MAX);
+        return 1;
+    }
+
+    printf("seg: %u bytes in %u segment(s) to %s, itvl %lu us\n",
+           size, (unsigned)SEG_CNT(size),
+           (dst == BT_MESH_ADDR_UNASSIGNED) ? "pub groups" : argv[4],
+           (unsigned long)itvl);
+
+    /* at most one message is in flight at a time: with an interval of 0 the
+     * next message is sent as soon as the previous one is done, otherwise
+     * messages are sent on the publish schedule */
+    pubsched_t sched;
+    _sched_init(&sched, (itvl > 0) ? itvl : 1, 0);
+    _cpu_reset();
+    _seg_stats_clear();
+    _pub_group_next = 0;
+
+    for (unsigned i = 0; i < cnt; i++) {
+        if (itvl > 0) {
+            _sched_wait(&sched);
+        }
+        mutex_lock(&_seg_lock);
+        uint16_t to = (dst != BT_MESH_ADDR_UNASSIGNED) ? dst : _pub_group_get();
+        int res = _seg_send(model, to, size, (uint16_t)(_addr_node + i));
+        if (res != 0) {
+            printf("err: unable to send message %u (%i)\n", i, res);
+            _seg_tx_fail++;
+            mutex_unlock(&_seg_lock);
+        }
+    }
+    /* wait for the last message to complete */
+    mutex_lock(&_seg_lock);
+    mutex_unlock(&_seg_lock);
+
+    if (itvl > 0) {
+        _sched_report(&sched);
+    }
     puts("EXP DONE");
 
     return 0;
@@ -517,11 +1725,18 @@ static int _cmd_run_lvl(int argc, char **argv)
 static const shell_command_t _shell_cmds[] = {
     { "clr", "reset stats", _cmd_clear },
     { "stats", "show stats", _cmd_stats },
-    { "cfg_source", "provision node as source", _cmd_cfg_source },
-    { "cfg_sink", "provision node as sink", _cmd_cfg_sink },
+    { "cfg_source", "provision node as source [num groups]", _cmd_cfg_source },
+    { "cfg_sink", "provision node as sink [num groups]", _cmd_cfg_sink },
+    { "prov", "provision node from binary blob", _cmd_prov },
     { "wl", "white list address", _cmd_wl },
+    { "sched", "set publish scheduler mode", _cmd_sched },
+    { "airtime", "show estimated transmit airtime", _cmd_airtime },
+    { "mem", "show stack and mempool usage", _cmd_mem },
+    { "cpu", "show CPU share per thread since clr/run [reset]", _cmd_cpu },
     { "run", "run the experiment", _cmd_run },
     { "run_lvl", "run exp, use level model", _cmd_run_lvl },
+    { "run_agg", "run exp, aggregate readings into vendor msgs", _cmd_run_agg },
+    { "run_seg", "run exp, segmented msgs [cnt itvl size [dst]]", _cmd_run_seg },
     { NULL, NULL, NULL }
 };
 
@@ -550,6 +1765,9 @@ int main(void)
     for (unsigned i = 0; i < (sizeof(_s_pub) / sizeof(_s_pub[0])); i++) {
         _s_pub[i].msg = NET_BUF_SIMPLE(2 + 4);
     }
+    for (unsigned i = 0; i < (sizeof(_s_pub_vnd) / sizeof(_s_pub_vnd[0])); i++) {
+        _s_pub_vnd[i].msg = NET_BUF_SIMPLE(AGG_SDU_MAX);
+    }
 
     /* initialize the mesh stack */
     res = bt_mesh_init(nimble_riot_own_addr_type, &_prov_cfg, &_node_comp);
@@ -566,6 +1784,7 @@ int main(void)
     puts("mesh init ok");
 
     _prov_base();
+    _cpu_reset();
 
     /* start the shell */
     char line_buf[SHELL_DEFAULT_BUFSIZE];
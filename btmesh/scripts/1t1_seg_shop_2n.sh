@@ -0,0 +1,115 @@
+#! /bin/sh -x
+#
+# Copyright (C) 2018 Cenk Gündoğan <cenk.guendogan@haw-hamburg.de>
+# Copyright (C) 2019 Peter Kietzmann <peter.kietzmann@haw-hamburg.de>
+# Copyright (C) 2019 Hauke Petersen <hauke.petersen@fu-berlin.de>
+#
+# Distributed under terms of the MIT license.
+#
+
+######################################
+###    Experiment Configuration    ###
+######################################
+# Name of the experiment, the resulting log file will have this name
+EXPNAME=1t1_seg_shop_2n
+# The nodes used for this experiment
+NUM_NODES=2
+# Number of messages per payload size, an interval of 0 sends back-to-back
+REQUESTS=100
+DELAY_REQUEST=0             # in us
+TIMEOUT=300                 # in sec
+# Payload sizes (bytes after the opcode), 8 bytes fit an unsegmented PDU
+SIZES="8 20 50 100 150 200"
+# Destination: empty to publish to the group, or the unicast address of the
+# sink's server element (node addr + 1, printed during boot) to get
+# acknowledged transfers
+SEG_DST="${SEG_DST:-}"
+# Maximum segments per message and advertising buffers to hold them
+MESH_SEG_MAX=20
+MESH_ADV_BUF_COUNT=32
+
+
+####################################
+###    Extended Configuration    ###
+####################################
+# Iot-lab user is automatically deducted from local configuration
+IOTLAB_USER="${IOTLAB_USER:-$(cut -f1 -d: ${HOME}/.iotlabrc)}"
+IOTLAB_SITE="${IOTLAB_SITE:-saclay}"
+SACLAY_NODES="1-${NUM_NODES}"
+# This value is highly overprovisioned, just in case...
+IOTLAB_DURATION=${IOTLAB_DURATION:-200}     # in min
+# Path to RIOT project used, per default we expect this script to be in the same path
+RIOTROOT="../fw"
+
+
+########################################
+###    Build the RIOT application    ###
+########################################
+MESH_SEG_MAX=${MESH_SEG_MAX} MESH_ADV_BUF_COUNT=${MESH_ADV_BUF_COUNT} \
+make -C ${RIOTROOT} -B clean all || {
+    echo "building firmware failed!"
+    exit 1
+}
+
+
+###################################
+###    Submit the experiment    ###
+###################################
+EXPID=$(iotlab-experiment submit -n ${EXPNAME} -d $((IOTLAB_DURATION + 3)) -l ${IOTLAB_SITE},nrf52dk,${SACLAY_NODES},${RIOTROOT}/bin/nrf52dk/${RIOTROOT##*/}.elf | grep -Po '[[:digit:]]+')
+if [ -z "${EXPID}" ]; then
+    echo "experiment submission failed!"
+    exit 1
+fi
+iotlab-experiment wait -i ${EXPID} || {
+    echo "experiment startup failed!"
+    exit 1
+}
+# Once successful, we generate the full filename for the output logfile
+NAME="${EXPNAME}_${EXPID}-${IOTLAB_SITE}_$(date +%d-%m-%Y"_"%H-%M)"
+
+
+################################
+###    Run the experiment    ###
+################################
+CMD_SETUPLOG=$(cat << CMD
+serial_aggregator -i ${EXPID} | tee ${NAME}.log
+CMD
+)
+
+CMD_EXPERIMENT="sleep 5"
+for SIZE in ${SIZES}; do
+CMD_EXPERIMENT=$(cat << CMD
+${CMD_EXPERIMENT}
+# Reboot and configure RIOT nodes for ${SIZE} byte messages
+tmux send-keys -t riot-${EXPID}:2 "reboot" C-m
+sleep 5
+tmux send-keys -t riot-${EXPID}:2 "nrf52dk-1;cfg_sink" C-m
+tmux send-keys -t riot-${EXPID}:2 "nrf52dk-2;cfg_source" C-m
+sleep 5
+
+# Run expiriment
+tmux send-keys -t riot-${EXPID}:2 "clr" C-m
+tmux send-keys -t riot-${EXPID}:2 "nrf52dk-2;run_seg ${REQUESTS} ${DELAY_REQUEST} ${SIZE} ${SEG_DST}" C-m
+sleep ${TIMEOUT}
+tmux send-keys -t riot-${EXPID}:2 "stats" C-m
+sleep 1
+CMD
+)
+done
+
+CMD_EXPERIMENT=$(cat << CMD
+${CMD_EXPERIMENT}
+
+# Cleanup
+iotlab-experiment stop -i ${EXPID} > /dev/null
+CMD
+)
+
+ssh ${IOTLAB_USER}@${IOTLAB_SITE}.iot-lab.info -t << EOF
+tmux new-session -d -s riot-${EXPID}
+tmux new-window -t riot-${EXPID}:2 "${CMD_SETUPLOG}"
+${CMD_EXPERIMENT}
+tmux kill-session -t riot-${EXPID}
+EOF
+
+exit 0
@@ -11,7 +11,7 @@
 ###    Experiment Configuration    ###
 ######################################
 # Name of the experiment, the resulting log file will have this name
-EXPNAME=mt1_shop_10n_100-5s
+EXPNAME=mt1_shop_10n_100-5s_${SCHED_MODE:-jitter}
 # The nodes used for this experiment
 NUM_NODES=10
 # Configure the traffic pattern and experiment runtime
@@ -19,6 +19,9 @@ REQUESTS=100
 DELAY_REQUEST=5000000       # in us
 DELAY_JITTER=2500000        # in us
 TIMEOUT=600                 # in sec
+# Publish scheduler: 'jitter' or 'slot' (source nrf52dk-N uses TX slot N-2 of
+# NUM_NODES-1 slots)
+SCHED_MODE=${SCHED_MODE:-jitter}
 
 
 ####################################
@@ -67,6 +70,15 @@ serial_aggregator -i ${EXPID} | tee ${NAME}.log
 CMD
 )
 
+if [ "${SCHED_MODE}" = "slot" ]; then
+    for N in $(seq 2 ${NUM_NODES}); do
+        SCHED_CMDS="${SCHED_CMDS}
+tmux send-keys -t riot-${EXPID}:2 \"nrf52dk-${N};sched slot $((NUM_NODES - 1)) $((N - 2))\" C-m"
+    done
+else
+    SCHED_CMDS="tmux send-keys -t riot-${EXPID}:2 \"sched ${SCHED_MODE}\" C-m"
+fi
+
 CMD_EXPERIMENT=$(cat << CMD
 # Reboot and configure RIOT nodes
 sleep 5
@@ -82,6 +94,7 @@ tmux send-keys -t riot-${EXPID}:2 "nrf52dk-7;cfg_source" C-m
 tmux send-keys -t riot-${EXPID}:2 "nrf52dk-8;cfg_source" C-m
 tmux send-keys -t riot-${EXPID}:2 "nrf52dk-9;cfg_source" C-m
 tmux send-keys -t riot-${EXPID}:2 "nrf52dk-10;cfg_source" C-m
+${SCHED_CMDS}
 
 # Probe for background traffic
 tmux send-keys -t riot-${EXPID}:2 "clr" C-m
@@ -103,6 +116,12 @@ tmux send-keys -t riot-${EXPID}:2 "nrf52dk-10;run_lvl ${REQUESTS} ${DELAY_REQUES
 sleep ${TIMEOUT}
 tmux send-keys -t riot-${EXPID}:2 "stats" C-m
 sleep 1
+tmux send-keys -t riot-${EXPID}:2 "airtime" C-m
+sleep 1
+tmux send-keys -t riot-${EXPID}:2 "cpu" C-m
+sleep 1
+tmux send-keys -t riot-${EXPID}:2 "mem" C-m
+sleep 1
 
 # Probe for background traffic
 tmux send-keys -t riot-${EXPID}:2 "clr" C-m
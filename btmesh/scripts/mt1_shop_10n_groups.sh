@@ -0,0 +1,145 @@
+#! /bin/sh -x
+#
+# Copyright (C) 2018 Cenk Gündoğan <cenk.guendogan@haw-hamburg.de>
+# Copyright (C) 2019 Peter Kietzmann <peter.kietzmann@haw-hamburg.de>
+# Copyright (C) 2019 Hauke Petersen <hauke.petersen@fu-berlin.de>
+#
+# Distributed under terms of the MIT license.
+#
+
+######################################
+###    Experiment Configuration    ###
+######################################
+# Name of the experiment, the resulting log file will have this name
+EXPNAME=mt1_shop_10n_groups
+# The nodes used for this experiment
+NUM_NODES=10
+# Configure the traffic pattern and experiment runtime
+REQUESTS=100
+DELAY_REQUEST=5000000       # in us
+DELAY_JITTER=2500000        # in us
+TIMEOUT=600                 # in sec
+# Number of groups the sources publish to (round-robin) and the sink
+# subscribes to, every combination is run once
+GROUPS_PUB="1 4 8 16 32"
+GROUPS_SUB="1 4 8 16 32"
+# Sizes of the network message cache, the firmware is rebuilt and the group
+# sweep is run as a separate experiment for every size
+CACHE_SIZES="10 32 64"
+
+
+####################################
+###    Extended Configuration    ###
+####################################
+# Iot-lab user is automatically deducted from local configuration
+IOTLAB_USER="${IOTLAB_USER:-$(cut -f1 -d: ${HOME}/.iotlabrc)}"
+IOTLAB_SITE="${IOTLAB_SITE:-saclay}"
+SACLAY_NODES="1-${NUM_NODES}"
+# Each (N, M) combination takes 5s for the reboot, the timeout and 3s for
+# stats, cpu and mem. The reservation of each cache size's experiment covers
+# its group sweep plus 20 min for flashing and startup, the cache sizes run
+# one after another.
+RUNS=$(( $(echo ${GROUPS_PUB} | wc -w) * $(echo ${GROUPS_SUB} | wc -w) ))
+IOTLAB_DURATION=${IOTLAB_DURATION:-$(( (RUNS * (TIMEOUT + 8)) / 60 + 20 ))}   # in min
+# Path to RIOT project used, per default we expect this script to be in the same path
+RIOTROOT="../fw"
+
+
+for C in ${CACHE_SIZES}; do
+########################################
+###    Build the RIOT application    ###
+########################################
+MESH_GROUP_COUNT=32 MESH_MSG_CACHE_SIZE=${C} make -C ${RIOTROOT} -B clean all || {
+    echo "building firmware failed!"
+    exit 1
+}
+
+
+###################################
+###    Submit the experiment    ###
+###################################
+EXPID=$(iotlab-experiment submit -n ${EXPNAME}_cache${C} -d $((IOTLAB_DURATION + 3)) -l ${IOTLAB_SITE},nrf52dk,${SACLAY_NODES},${RIOTROOT}/bin/nrf52dk/${RIOTROOT##*/}.elf | grep -Po '[[:digit:]]+')
+if [ -z "${EXPID}" ]; then
+    echo "experiment submission failed!"
+    exit 1
+fi
+iotlab-experiment wait -i ${EXPID} || {
+    echo "experiment startup failed!"
+    exit 1
+}
+# Once successful, we generate the full filename for the output logfile
+NAME="${EXPNAME}_cache${C}_${EXPID}-${IOTLAB_SITE}_$(date +%d-%m-%Y"_"%H-%M)"
+
+
+################################
+###    Run the experiment    ###
+################################
+CMD_SETUPLOG=$(cat << CMD
+serial_aggregator -i ${EXPID} | tee ${NAME}.log
+CMD
+)
+
+CMD_EXPERIMENT="sleep 5"
+for N in ${GROUPS_PUB}; do
+for M in ${GROUPS_SUB}; do
+# provisioning blobs: role | group 0xc001 (LE) | num groups | TTL | transmit
+PROV_SOURCE="0101c0$(printf '%02x' ${N})0f00"
+PROV_SINK="0201c0$(printf '%02x' ${M})0f00"
+CMD_EXPERIMENT=$(cat << CMD
+${CMD_EXPERIMENT}
+# Reboot and configure RIOT nodes for ${N} publish and ${M} subscribe groups,
+# message cache size ${C}
+tmux send-keys -t riot-${EXPID}:2 "reboot" C-m
+sleep 5
+tmux send-keys -t riot-${EXPID}:2 "nrf52dk-1;prov ${PROV_SINK}" C-m
+tmux send-keys -t riot-${EXPID}:2 "nrf52dk-2;prov ${PROV_SOURCE}" C-m
+tmux send-keys -t riot-${EXPID}:2 "nrf52dk-3;prov ${PROV_SOURCE}" C-m
+tmux send-keys -t riot-${EXPID}:2 "nrf52dk-4;prov ${PROV_SOURCE}" C-m
+tmux send-keys -t riot-${EXPID}:2 "nrf52dk-5;prov ${PROV_SOURCE}" C-m
+tmux send-keys -t riot-${EXPID}:2 "nrf52dk-6;prov ${PROV_SOURCE}" C-m
+tmux send-keys -t riot-${EXPID}:2 "nrf52dk-7;prov ${PROV_SOURCE}" C-m
+tmux send-keys -t riot-${EXPID}:2 "nrf52dk-8;prov ${PROV_SOURCE}" C-m
+tmux send-keys -t riot-${EXPID}:2 "nrf52dk-9;prov ${PROV_SOURCE}" C-m
+tmux send-keys -t riot-${EXPID}:2 "nrf52dk-10;prov ${PROV_SOURCE}" C-m
+
+# Run expiriment
+tmux send-keys -t riot-${EXPID}:2 "clr" C-m
+tmux send-keys -t riot-${EXPID}:2 "nrf52dk-2;run_lvl ${REQUESTS} ${DELAY_REQUEST} ${DELAY_JITTER}" C-m
+tmux send-keys -t riot-${EXPID}:2 "nrf52dk-3;run_lvl ${REQUESTS} ${DELAY_REQUEST} ${DELAY_JITTER}" C-m
+tmux send-keys -t riot-${EXPID}:2 "nrf52dk-4;run_lvl ${REQUESTS} ${DELAY_REQUEST} ${DELAY_JITTER}" C-m
+tmux send-keys -t riot-${EXPID}:2 "nrf52dk-5;run_lvl ${REQUESTS} ${DELAY_REQUEST} ${DELAY_JITTER}" C-m
+tmux send-keys -t riot-${EXPID}:2 "nrf52dk-6;run_lvl ${REQUESTS} ${DELAY_REQUEST} ${DELAY_JITTER}" C-m
+tmux send-keys -t riot-${EXPID}:2 "nrf52dk-7;run_lvl ${REQUESTS} ${DELAY_REQUEST} ${DELAY_JITTER}" C-m
+tmux send-keys -t riot-${EXPID}:2 "nrf52dk-8;run_lvl ${REQUESTS} ${DELAY_REQUEST} ${DELAY_JITTER}" C-m
+tmux send-keys -t riot-${EXPID}:2 "nrf52dk-9;run_lvl ${REQUESTS} ${DELAY_REQUEST} ${DELAY_JITTER}" C-m
+tmux send-keys -t riot-${EXPID}:2 "nrf52dk-10;run_lvl ${REQUESTS} ${DELAY_REQUEST} ${DELAY_JITTER}" C-m
+sleep ${TIMEOUT}
+# per group counters, CPU share and memory usage of the stack on the sink
+tmux send-keys -t riot-${EXPID}:2 "stats" C-m
+sleep 1
+tmux send-keys -t riot-${EXPID}:2 "nrf52dk-1;cpu" C-m
+sleep 1
+tmux send-keys -t riot-${EXPID}:2 "nrf52dk-1;mem" C-m
+sleep 1
+CMD
+)
+done
+done
+
+CMD_EXPERIMENT=$(cat << CMD
+${CMD_EXPERIMENT}
+
+# Cleanup
+iotlab-experiment stop -i ${EXPID} > /dev/null
+CMD
+)
+
+ssh ${IOTLAB_USER}@${IOTLAB_SITE}.iot-lab.info -t << EOF
+tmux new-session -d -s riot-${EXPID}
+tmux new-window -t riot-${EXPID}:2 "${CMD_SETUPLOG}"
+${CMD_EXPERIMENT}
+tmux kill-session -t riot-${EXPID}
+EOF
+done
+
+exit 0
@@ -0,0 +1,71 @@
+#! /bin/sh
+#
+# Copyright (C) 2019 Freie Universität Berlin
+#
+# Distributed under terms of the MIT license.
+#
+# Compares a testbed log with a simulator run of the matching scenario: both
+# logs are analyzed with ../../tools/analyzer and the delivery of every flow
+# is printed side by side as CSV, followed by the total of all flows.
+#
+# usage: ./compare.sh <testbed log>
+
+######################################
+###    Experiment Configuration    ###
+######################################
+SCENARIO="${SCENARIO:-scenarios/1tm_shop_10n.txt}"
+TOPOLOGY="${TOPOLOGY:-full}"
+NUM_NODES=${NUM_NODES:-10}
+# further simulator options, e.g. "-l 0.1 -x 2,20"
+SIMOPTS="${SIMOPTS:-}"
+
+if [ $# -ne 1 ] || [ ! -f "$1" ]; then
+    echo "usage: $0 <testbed log>"
+    exit 1
+fi
+TESTBED_LOG="$1"
+
+DIR="$(dirname $0)"
+ANALYZER_DIR="${DIR}/../../tools/analyzer"
+make -C "${DIR}" > /dev/null || {
+    echo "building simulator failed!"
+    exit 1
+}
+make -C "${ANALYZER_DIR}" > /dev/null || {
+    echo "building analyzer failed!"
+    exit 1
+}
+
+TMP=$(mktemp -d)
+trap 'rm -rf ${TMP}' EXIT
+
+${DIR}/bin/btmesh-sim -n ${NUM_NODES} -t ${TOPOLOGY} ${SIMOPTS} \
+    "${DIR}/${SCENARIO}" > ${TMP}/sim.log 2> /dev/null || {
+    echo "simulator run failed!"
+    exit 1
+}
+${ANALYZER_DIR}/bin/analyzer -o ${TMP}/testbed "${TESTBED_LOG}" 2> /dev/null &&
+${ANALYZER_DIR}/bin/analyzer -o ${TMP}/sim ${TMP}/sim.log 2> /dev/null || {
+    echo "analyzing the logs failed!"
+    exit 1
+}
+
+# flows are joined on run, source and sink
+echo "run,src,dst,testbed_tx,testbed_delivered,testbed_ratio,sim_tx,sim_delivered,sim_ratio"
+awk -F, '
+    FNR == 1 { next }
+    NR == FNR { sim[$1 FS $2 FS $3] = $4 FS $5 FS $7; next }
+    {
+        key = $1 FS $2 FS $3
+        s = (key in sim) ? sim[key] : "0,0,0"
+        split(s, v, FS)
+        print key "," $4 "," $5 "," $7 "," s
+        tb_tx += $4; tb_rx += $5; sim_tx += v[1]; sim_rx += v[2]
+    }
+    END {
+        printf "all,,,%d,%d,%g,%d,%d,%g\n", tb_tx, tb_rx,
+               (tb_tx > 0) ? tb_rx / tb_tx : 0, sim_tx, sim_rx,
+               (sim_tx > 0) ? sim_rx / sim_tx : 0
+    }' ${TMP}/sim_flows.csv ${TMP}/testbed_flows.csv
+
+exit 0
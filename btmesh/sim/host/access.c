@@ -0,0 +1,546 @@
+/*
+ * Copyright (C) 2019 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Host access layer: composition, provisioning, models and the
+ *              local configuration client
+ *
+ * @}
+ */
+
+#include <string.h>
+
+#include "host.h"
+#include "sim.h"
+
+#define STATUS_SUCCESS          (0x00)
+#define STATUS_INVALID_ADDRESS  (0x01)
+#define STATUS_INVALID_MODEL    (0x02)
+#define STATUS_INVALID_APPKEY   (0x03)
+#define STATUS_INSUFF_RESOURCES (0x05)
+#define STATUS_NVAL_PUB_PARAM   (0x07)
+
+struct bt_mesh_net bt_mesh;
+
+static const struct bt_mesh_comp *_comp = NULL;
+static const struct bt_mesh_prov *_prov = NULL;
+static struct bt_mesh_cfg_srv *_cfg_srv = NULL;
+
+static unsigned _model_count(const struct bt_mesh_elem *elem)
+{
+    return elem->model_count + elem->vnd_model_count;
+}
+
+/* SIG models first, then vendor models */
+static struct bt_mesh_model *_model_get(struct bt_mesh_elem *elem, unsigned i)
+{
+    return (i < elem->model_count) ? &elem->models[i]
+                                   : &elem->vnd_models[i - elem->model_count];
+}
+
+int bt_mesh_init(u8_t own_addr_type, const struct bt_mesh_prov *prov,
+                 const struct bt_mesh_comp *comp)
+{
+    (void)own_addr_type;
+
+    _prov = prov;
+    _comp = comp;
+    for (unsigned i = 0; i < ARRAY_SIZE(bt_mesh.app_keys); i++) {
+        bt_mesh.app_keys[i].net_idx = BT_MESH_KEY_UNUSED;
+        bt_mesh.app_keys[i].app_idx = BT_MESH_KEY_UNUSED;
+    }
+
+    for (unsigned e = 0; e < comp->elem_count; e++) {
+        struct bt_mesh_elem *elem = &comp->elem[e];
+        for (unsigned m = 0; m < _model_count(elem); m++) {
+            struct bt_mesh_model *model = _model_get(elem, m);
+            model->elem_idx = (u8_t)e;
+            model->mod_idx = (u8_t)((m < elem->model_count)
+                                    ? m : (m - elem->model_count));
+            for (unsigned i = 0; i < ARRAY_SIZE(model->keys); i++) {
+                model->keys[i] = BT_MESH_KEY_UNUSED;
+            }
+            memset(model->groups, 0, sizeof(model->groups));
+            if (model->pub) {
+                model->pub->mod = model;
+            }
+            if (!model->vnd && (model->id == BT_MESH_MODEL_ID_CFG_SRV)) {
+                _cfg_srv = model->user_data;
+                _cfg_srv->model = model;
+            }
+        }
+    }
+    if (_cfg_srv == NULL) {
+        return -EINVAL;
+    }
+
+    /* network transmit and relay settings given on the command line */
+    sim_mesh_cfg(&_cfg_srv->relay, &_cfg_srv->net_transmit,
+                 &_cfg_srv->relay_retransmit);
+    return 0;
+}
+
+int bt_mesh_provision(const u8_t net_key[16], u16_t net_idx, u8_t flags,
+                      u32_t iv_index, u16_t addr, const u8_t dev_key[16])
+{
+    (void)net_key;
+    (void)flags;
+    (void)dev_key;
+
+    if (bt_mesh.provisioned) {
+        return -EALREADY;
+    }
+    bt_mesh.provisioned = true;
+    bt_mesh.addr = addr;
+    bt_mesh.iv_index = iv_index;
+    bt_mesh.seq = 0;
+    bt_mesh.sub.net_idx = net_idx;
+    for (unsigned i = 0; i < _comp->elem_count; i++) {
+        _comp->elem[i].addr = (u16_t)(addr + i);
+    }
+    if (_prov && _prov->complete) {
+        _prov->complete(net_idx, addr);
+    }
+    return 0;
+}
+
+int bt_mesh_app_id(const u8_t app_key[16], u8_t *app_id)
+{
+    /* stands in for the k4 derivation, the AID is not checked on rx */
+    *app_id = app_key[0] & 0x3f;
+    return 0;
+}
+
+u8_t bt_mesh_net_transmit_get(void)
+{
+    return (_cfg_srv) ? _cfg_srv->net_transmit : 0;
+}
+
+u8_t bt_mesh_relay_retransmit_get(void)
+{
+    return (_cfg_srv) ? _cfg_srv->relay_retransmit : 0;
+}
+
+u8_t bt_mesh_relay_get(void)
+{
+    return (_cfg_srv) ? _cfg_srv->relay : BT_MESH_RELAY_DISABLED;
+}
+
+u8_t host_default_ttl(void)
+{
+    return (_cfg_srv) ? _cfg_srv->default_ttl : 7;
+}
+
+struct bt_mesh_elem *host_elem_find(u16_t addr)
+{
+    if (!bt_mesh.provisioned || !BT_MESH_ADDR_IS_UNICAST(addr) ||
+        (addr < bt_mesh.addr) || (addr >= (bt_mesh.addr + _comp->elem_count))) {
+        return NULL;
+    }
+    return &_comp->elem[addr - bt_mesh.addr];
+}
+
+struct bt_mesh_model *host_model_find(struct bt_mesh_elem *elem, u16_t id,
+                                      u16_t cid, bool vnd)
+{
+    if (vnd) {
+        for (unsigned i = 0; i < elem->vnd_model_count; i++) {
+            if ((elem->vnd_models[i].id == id) &&
+                (elem->vnd_models[i].cid == cid)) {
+                return &elem->vnd_models[i];
+            }
+        }
+        return NULL;
+    }
+    for (unsigned i = 0; i < elem->model_count; i++) {
+        if (elem->models[i].id == id) {
+            return &elem->models[i];
+        }
+    }
+    return NULL;
+}
+
+static bool _model_has_group(const struct bt_mesh_model *model, u16_t addr)
+{
+    for (unsigned i = 0; i < ARRAY_SIZE(model->groups); i++) {
+        if (model->groups[i] == addr) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool _model_has_key(const struct bt_mesh_model *model, u16_t app_idx)
+{
+    for (unsigned i = 0; i < ARRAY_SIZE(model->keys); i++) {
+        if (model->keys[i] == app_idx) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool host_group_subscribed(u16_t addr)
+{
+    for (unsigned e = 0; _comp && (e < _comp->elem_count); e++) {
+        struct bt_mesh_elem *elem = &_comp->elem[e];
+        for (unsigned m = 0; m < _model_count(elem); m++) {
+            if (_model_has_group(_model_get(elem, m), addr)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+int host_is_sink(void)
+{
+    for (unsigned e = 0; _comp && (e < _comp->elem_count); e++) {
+        struct bt_mesh_elem *elem = &_comp->elem[e];
+        for (unsigned m = 0; m < _model_count(elem); m++) {
+            if (_model_get(elem, m)->groups[0] != BT_MESH_ADDR_UNASSIGNED) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* ---- messages ----------------------------------------------------------- */
+
+void bt_mesh_model_msg_init(struct os_mbuf *msg, u32_t opcode)
+{
+    net_buf_simple_init(msg, 0);
+    if (opcode < 0x100) {
+        net_buf_simple_add_u8(msg, (u8_t)opcode);
+    }
+    else if (opcode < 0x10000) {
+        net_buf_simple_add_be16(msg, (u16_t)opcode);
+    }
+    else {
+        net_buf_simple_add_u8(msg, (u8_t)(opcode >> 16));
+        net_buf_simple_add_le16(msg, (u16_t)opcode);
+    }
+}
+
+static int _get_opcode(const u8_t *data, size_t len, u32_t *opcode)
+{
+    if (len < 1) {
+        return -EINVAL;
+    }
+    switch (data[0] >> 6) {
+        case 0x00:
+        case 0x01:
+            if (data[0] == 0x7f) {
+                return -EINVAL;
+            }
+            *opcode = data[0];
+            return 1;
+        case 0x02:
+            if (len < 2) {
+                return -EINVAL;
+            }
+            *opcode = ((u32_t)data[0] << 8) | data[1];
+            return 2;
+        default:
+            if (len < 3) {
+                return -EINVAL;
+            }
+            *opcode = ((u32_t)data[0] << 16) | ((u32_t)data[2] << 8) | data[1];
+            return 3;
+    }
+}
+
+static void _model_recv(struct bt_mesh_model *model,
+                        struct bt_mesh_msg_ctx *ctx, u32_t opcode,
+                        const u8_t *data, size_t len)
+{
+    for (const struct bt_mesh_model_op *op = model->op; op->func; op++) {
+        if (op->opcode != opcode) {
+            continue;
+        }
+        if (len < op->min_len) {
+            return;
+        }
+        /* every model gets its own copy of the parameters */
+        struct os_mbuf *buf = host_mbuf_alloc((uint16_t)len, 0);
+        net_buf_simple_add_mem(buf, data, len);
+        op->func(model, ctx, buf);
+        os_mbuf_free_chain(buf);
+        return;
+    }
+}
+
+void host_access_recv(struct bt_mesh_msg_ctx *ctx, const u8_t *data,
+                      size_t len)
+{
+    u32_t opcode;
+    int op_len = _get_opcode(data, len, &opcode);
+    if (op_len < 0) {
+        return;
+    }
+
+    /* access messages are always encrypted with our one app key */
+    ctx->app_idx = BT_MESH_KEY_UNUSED;
+    for (unsigned i = 0; i < ARRAY_SIZE(bt_mesh.app_keys); i++) {
+        if (bt_mesh.app_keys[i].net_idx != BT_MESH_KEY_UNUSED) {
+            ctx->app_idx = bt_mesh.app_keys[i].app_idx;
+            break;
+        }
+    }
+    if (ctx->app_idx == BT_MESH_KEY_UNUSED) {
+        return;
+    }
+
+    u16_t dst = ctx->recv_dst;
+    for (unsigned e = 0; e < _comp->elem_count; e++) {
+        struct bt_mesh_elem *elem = &_comp->elem[e];
+        /* unicast: the addressed element, all-nodes: the primary element */
+        if ((BT_MESH_ADDR_IS_UNICAST(dst) && (elem->addr != dst)) ||
+            ((dst == BT_MESH_ADDR_ALL_NODES) && (e != 0))) {
+            continue;
+        }
+        for (unsigned m = 0; m < _model_count(elem); m++) {
+            struct bt_mesh_model *model = _model_get(elem, m);
+            if (BT_MESH_ADDR_IS_GROUP(dst) && !_model_has_group(model, dst)) {
+                continue;
+            }
+            if ((model->op == NULL) || !_model_has_key(model, ctx->app_idx)) {
+                continue;
+            }
+            _model_recv(model, ctx, opcode, &data[op_len], len - op_len);
+        }
+    }
+}
+
+static u16_t _model_addr(const struct bt_mesh_model *model)
+{
+    return _comp->elem[model->elem_idx].addr;
+}
+
+int bt_mesh_model_send(struct bt_mesh_model *model,
+                       struct bt_mesh_msg_ctx *ctx, struct os_mbuf *msg,
+                       const struct bt_mesh_send_cb *cb, void *cb_data)
+{
+    if (!bt_mesh.provisioned) {
+        return -EAGAIN;
+    }
+    if (!_model_has_key(model, ctx->app_idx)) {
+        return -EINVAL;
+    }
+
+    struct bt_mesh_net_tx tx = {
+        .sub = &bt_mesh.sub,
+        .ctx = ctx,
+        .src = _model_addr(model),
+        .xmit = bt_mesh_net_transmit_get(),
+    };
+    return bt_mesh_trans_send(&tx, msg->om_data, msg->om_len, cb, cb_data);
+}
+
+/* publish retransmissions (pub->retransmit) are not modeled */
+int bt_mesh_model_publish(struct bt_mesh_model *model)
+{
+    struct bt_mesh_model_pub *pub = model->pub;
+
+    if (pub == NULL) {
+        return -ENOTSUP;
+    }
+    if (pub->addr == BT_MESH_ADDR_UNASSIGNED) {
+        return -EADDRNOTAVAIL;
+    }
+
+    struct bt_mesh_msg_ctx ctx = {
+        .net_idx = bt_mesh.sub.net_idx,
+        .app_idx = pub->key,
+        .addr = pub->addr,
+        .send_ttl = pub->ttl,
+    };
+    return bt_mesh_model_send(model, &ctx, pub->msg, NULL, NULL);
+}
+
+/* ---- configuration client ----------------------------------------------- */
+
+static int _cfg_model_get(u16_t addr, u16_t elem_addr, u16_t mod_id,
+                          u16_t cid, bool vnd, struct bt_mesh_model **model,
+                          u8_t *status)
+{
+    /* only the local node can be configured */
+    if (!bt_mesh.provisioned || (addr != bt_mesh.addr)) {
+        return -ETIMEDOUT;
+    }
+
+    struct bt_mesh_elem *elem = host_elem_find(elem_addr);
+    *model = (elem) ? host_model_find(elem, mod_id, cid, vnd) : NULL;
+    if (status) {
+        *status = (elem == NULL) ? STATUS_INVALID_ADDRESS
+                : (*model == NULL) ? STATUS_INVALID_MODEL : STATUS_SUCCESS;
+    }
+    return 0;
+}
+
+static bool _app_key_exists(u16_t app_idx)
+{
+    for (unsigned i = 0; i < ARRAY_SIZE(bt_mesh.app_keys); i++) {
+        if ((bt_mesh.app_keys[i].net_idx != BT_MESH_KEY_UNUSED) &&
+            (bt_mesh.app_keys[i].app_idx == app_idx)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static u8_t _mod_app_bind(struct bt_mesh_model *model, u16_t app_idx)
+{
+    if (!_app_key_exists(app_idx)) {
+        return STATUS_INVALID_APPKEY;
+    }
+    if (_model_has_key(model, app_idx)) {
+        return STATUS_SUCCESS;
+    }
+    for (unsigned i = 0; i < ARRAY_SIZE(model->keys); i++) {
+        if (model->keys[i] == BT_MESH_KEY_UNUSED) {
+            model->keys[i] = app_idx;
+            return STATUS_SUCCESS;
+        }
+    }
+    return STATUS_INSUFF_RESOURCES;
+}
+
+static u8_t _mod_pub_set(struct bt_mesh_model *model,
+                         const struct bt_mesh_cfg_mod_pub *pub)
+{
+    if (model->pub == NULL) {
+        return STATUS_NVAL_PUB_PARAM;
+    }
+    if ((pub->addr != BT_MESH_ADDR_UNASSIGNED) &&
+        !_app_key_exists(pub->app_idx)) {
+        return STATUS_INVALID_APPKEY;
+    }
+    model->pub->addr = pub->addr;
+    model->pub->key = pub->app_idx;
+    model->pub->cred = pub->cred_flag;
+    model->pub->ttl = pub->ttl;
+    model->pub->period = pub->period;
+    model->pub->retransmit = pub->transmit;
+    return STATUS_SUCCESS;
+}
+
+static u8_t _mod_sub_add(struct bt_mesh_model *model, u16_t sub_addr)
+{
+    if (!BT_MESH_ADDR_IS_GROUP(sub_addr)) {
+        return STATUS_INVALID_ADDRESS;
+    }
+    if (_model_has_group(model, sub_addr)) {
+        return STATUS_SUCCESS;
+    }
+    for (unsigned i = 0; i < ARRAY_SIZE(model->groups); i++) {
+        if (model->groups[i] == BT_MESH_ADDR_UNASSIGNED) {
+            model->groups[i] = sub_addr;
+            return STATUS_SUCCESS;
+        }
+    }
+    return STATUS_INSUFF_RESOURCES;
+}
+
+static int _cfg_app_bind(u16_t addr, u16_t elem_addr, u16_t mod_app_idx,
+                         u16_t mod_id, u16_t cid, bool vnd, u8_t *status)
+{
+    struct bt_mesh_model *model;
+    u8_t res;
+    int err = _cfg_model_get(addr, elem_addr, mod_id, cid, vnd, &model, &res);
+    if ((err == 0) && (model != NULL)) {
+        res = _mod_app_bind(model, mod_app_idx);
+    }
+    if ((err == 0) && status) {
+        *status = res;
+    }
+    return err;
+}
+
+static int _cfg_pub_set(u16_t addr, u16_t elem_addr, u16_t mod_id, u16_t cid,
+                        bool vnd, struct bt_mesh_cfg_mod_pub *pub,
+                        u8_t *status)
+{
+    struct bt_mesh_model *model;
+    u8_t res;
+    int err = _cfg_model_get(addr, elem_addr, mod_id, cid, vnd, &model, &res);
+    if ((err == 0) && (model != NULL)) {
+        res = _mod_pub_set(model, pub);
+    }
+    if ((err == 0) && status) {
+        *status = res;
+    }
+    return err;
+}
+
+static int _cfg_sub_add(u16_t addr, u16_t elem_addr, u16_t sub_addr,
+                        u16_t mod_id, u16_t cid, bool vnd, u8_t *status)
+{
+    struct bt_mesh_model *model;
+    u8_t res;
+    int err = _cfg_model_get(addr, elem_addr, mod_id, cid, vnd, &model, &res);
+    if ((err == 0) && (model != NULL)) {
+        res = _mod_sub_add(model, sub_addr);
+    }
+    if ((err == 0) && status) {
+        *status = res;
+    }
+    return err;
+}
+
+int bt_mesh_cfg_mod_app_bind(u16_t net_idx, u16_t addr, u16_t elem_addr,
+                             u16_t mod_app_idx, u16_t mod_id, u8_t *status)
+{
+    (void)net_idx;
+    return _cfg_app_bind(addr, elem_addr, mod_app_idx, mod_id, 0, false,
+                         status);
+}
+
+int bt_mesh_cfg_mod_app_bind_vnd(u16_t net_idx, u16_t addr, u16_t elem_addr,
+                                 u16_t mod_app_idx, u16_t mod_id, u16_t cid,
+                                 u8_t *status)
+{
+    (void)net_idx;
+    return _cfg_app_bind(addr, elem_addr, mod_app_idx, mod_id, cid, true,
+                         status);
+}
+
+int bt_mesh_cfg_mod_pub_set(u16_t net_idx, u16_t addr, u16_t elem_addr,
+                            u16_t mod_id, struct bt_mesh_cfg_mod_pub *pub,
+                            u8_t *status)
+{
+    (void)net_idx;
+    return _cfg_pub_set(addr, elem_addr, mod_id, 0, false, pub, status);
+}
+
+int bt_mesh_cfg_mod_pub_set_vnd(u16_t net_idx, u16_t addr, u16_t elem_addr,
+                                u16_t mod_id, u16_t cid,
+                                struct bt_mesh_cfg_mod_pub *pub, u8_t *status)
+{
+    (void)net_idx;
+    return _cfg_pub_set(addr, elem_addr, mod_id, cid, true, pub, status);
+}
+
+int bt_mesh_cfg_mod_sub_add(u16_t net_idx, u16_t addr, u16_t elem_addr,
+                            u16_t sub_addr, u16_t mod_id, u8_t *status)
+{
+    (void)net_idx;
+    return _cfg_sub_add(addr, elem_addr, sub_addr, mod_id, 0, false, status);
+}
+
+int bt_mesh_cfg_mod_sub_add_vnd(u16_t net_idx, u16_t addr, u16_t elem_addr,
+                                u16_t sub_addr, u16_t mod_id, u16_t cid,
+                                u8_t *status)
+{
+    (void)net_idx;
+    return _cfg_sub_add(addr, elem_addr, sub_addr, mod_id, cid, true, status);
+}
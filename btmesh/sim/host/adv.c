@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2019 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Host advertising layer: buffer pool and hand-off to the core
+ *
+ * Advertising buffers come from a pool of BLE_MESH_ADV_BUF_COUNT buffers and
+ * are reference counted like NimBLE's: a buffer stays allocated while it is
+ * queued or advertised by the core and while the lower transport holds it
+ * for retransmission.
+ *
+ * @}
+ */
+
+#include <string.h>
+
+#include "host.h"
+#include "sim.h"
+
+#define ADV_DATA_SIZE           (29U)
+#define ADV_INT_MIN             (20U)   /* ms */
+
+uint8_t nimble_riot_own_addr_type = 0;
+
+static struct os_mempool _adv_pool = {
+    .name = "adv",
+    .blocks = MYNEWT_VAL(BLE_MESH_ADV_BUF_COUNT),
+    .free = MYNEWT_VAL(BLE_MESH_ADV_BUF_COUNT),
+    .min_free = MYNEWT_VAL(BLE_MESH_ADV_BUF_COUNT),
+    .block_size = ADV_DATA_SIZE,
+};
+
+void mesh_adv_thread(void *arg)
+{
+    /* the core advertises the queued buffers */
+    (void)arg;
+}
+
+struct os_mbuf *host_adv_create(u8_t xmit)
+{
+    if (_adv_pool.free == 0) {
+        return NULL;
+    }
+    if (--_adv_pool.free < _adv_pool.min_free) {
+        _adv_pool.min_free = _adv_pool.free;
+    }
+    struct os_mbuf *buf = host_mbuf_alloc(ADV_DATA_SIZE, 0);
+    BT_MESH_ADV(buf)->xmit = xmit;
+    return buf;
+}
+
+void host_adv_unref(struct os_mbuf *buf)
+{
+    if (--buf->om_ref == 0) {
+        os_mbuf_free_chain(buf);
+        _adv_pool.free++;
+    }
+}
+
+void bt_mesh_adv_send(struct os_mbuf *buf, const struct bt_mesh_send_cb *cb,
+                      void *cb_data)
+{
+    BT_MESH_ADV(buf)->cb = cb;
+    BT_MESH_ADV(buf)->cb_data = cb_data;
+    BT_MESH_ADV(buf)->busy = 1;
+    buf->om_ref++;
+    sim_adv_send(buf->om_data, buf->om_len, BT_MESH_ADV(buf)->xmit, buf);
+}
+
+void host_adv_cb(void *ref, int done)
+{
+    struct os_mbuf *buf = ref;
+    const struct bt_mesh_send_cb *cb = BT_MESH_ADV(buf)->cb;
+    void *cb_data = BT_MESH_ADV(buf)->cb_data;
+    kernel_pid_t pid = host_pid_enter();
+
+    if (!done) {
+        if (cb && cb->start) {
+            u8_t xmit = BT_MESH_ADV(buf)->xmit;
+            unsigned itvl = BT_MESH_TRANSMIT_INT(xmit);
+            if (itvl < ADV_INT_MIN) {
+                itvl = ADV_INT_MIN;
+            }
+            cb->start((u16_t)((BT_MESH_TRANSMIT_COUNT(xmit) + 1) * (itvl + 10)),
+                      0, cb_data);
+        }
+    }
+    else {
+        BT_MESH_ADV(buf)->busy = 0;
+        if (cb && cb->end) {
+            cb->end(0, cb_data);
+        }
+        host_adv_unref(buf);
+    }
+    host_pid_leave(pid);
+}
+
+void host_rx(const uint8_t *data, size_t len, const uint8_t *adv_addr)
+{
+    if (!host_filter_accepts(adv_addr)) {
+        return;
+    }
+    kernel_pid_t pid = host_pid_enter();
+    host_net_recv(data, len);
+    host_pid_leave(pid);
+}
+
+struct os_mempool *os_mempool_info_get_next(struct os_mempool *mp,
+                                            struct os_mempool_info *omi)
+{
+    if (mp != NULL) {
+        return NULL;
+    }
+    mp = &_adv_pool;
+    omi->omi_block_size = mp->block_size;
+    omi->omi_num_blocks = mp->blocks;
+    omi->omi_num_free = mp->free;
+    omi->omi_min_free = mp->min_free;
+    strncpy(omi->omi_name, mp->name, sizeof(omi->omi_name) - 1);
+    omi->omi_name[sizeof(omi->omi_name) - 1] = '\0';
+    return mp;
+}
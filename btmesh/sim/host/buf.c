@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2019 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Host mbufs: single heap buffers with the net_buf_simple API
+ *
+ * @}
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "host.h"
+
+struct os_mbuf *host_mbuf_alloc(uint16_t size, uint16_t headroom)
+{
+    struct os_mbuf *om = malloc(sizeof(struct os_mbuf) + headroom + size);
+    assert(om != NULL);
+
+    memset(om, 0, sizeof(struct os_mbuf));
+    om->om_size = headroom + size;
+    om->om_data = &om->om_databuf[headroom];
+    om->om_ref = 1;
+    return om;
+}
+
+void os_mbuf_free_chain(struct os_mbuf *om)
+{
+    free(om);
+}
+
+void net_buf_simple_init(struct os_mbuf *buf, size_t reserve_head)
+{
+    assert(reserve_head <= buf->om_size);
+    buf->om_data = &buf->om_databuf[reserve_head];
+    buf->om_len = 0;
+}
+
+void *net_buf_simple_add(struct os_mbuf *buf, size_t len)
+{
+    uint8_t *tail = buf->om_data + buf->om_len;
+    assert((tail + len) <= &buf->om_databuf[buf->om_size]);
+    buf->om_len += len;
+    return tail;
+}
+
+void net_buf_simple_add_mem(struct os_mbuf *buf, const void *mem, size_t len)
+{
+    memcpy(net_buf_simple_add(buf, len), mem, len);
+}
+
+void net_buf_simple_add_u8(struct os_mbuf *buf, u8_t val)
+{
+    *(u8_t *)net_buf_simple_add(buf, 1) = val;
+}
+
+void net_buf_simple_add_le16(struct os_mbuf *buf, u16_t val)
+{
+    u8_t *p = net_buf_simple_add(buf, 2);
+    p[0] = (u8_t)val;
+    p[1] = (u8_t)(val >> 8);
+}
+
+void net_buf_simple_add_be16(struct os_mbuf *buf, u16_t val)
+{
+    u8_t *p = net_buf_simple_add(buf, 2);
+    p[0] = (u8_t)(val >> 8);
+    p[1] = (u8_t)val;
+}
+
+void *net_buf_simple_push(struct os_mbuf *buf, size_t len)
+{
+    assert((buf->om_data - len) >= buf->om_databuf);
+    buf->om_data -= len;
+    buf->om_len += len;
+    return buf->om_data;
+}
+
+void *net_buf_simple_pull(struct os_mbuf *buf, size_t len)
+{
+    assert(buf->om_len >= len);
+    buf->om_len -= len;
+    buf->om_data += len;
+    return buf->om_data;
+}
+
+u8_t net_buf_simple_pull_u8(struct os_mbuf *buf)
+{
+    u8_t val = buf->om_data[0];
+    net_buf_simple_pull(buf, 1);
+    return val;
+}
+
+u16_t net_buf_simple_pull_le16(struct os_mbuf *buf)
+{
+    u16_t val = (u16_t)(buf->om_data[0] | (buf->om_data[1] << 8));
+    net_buf_simple_pull(buf, 2);
+    return val;
+}
+
+u16_t net_buf_simple_pull_be16(struct os_mbuf *buf)
+{
+    u16_t val = (u16_t)((buf->om_data[0] << 8) | buf->om_data[1]);
+    net_buf_simple_pull(buf, 2);
+    return val;
+}
@@ -0,0 +1,541 @@
+/*
+ * Copyright (C) 2019 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Host replacement for the RIOT and NimBLE APIs of the firmware
+ *
+ * Every RIOT and NimBLE header included by ../../fw/main.c resolves to this
+ * file (see the Makefile). It declares the subset of both APIs the firmware
+ * uses, with the same names, types and semantics, backed by the simulator:
+ * - RIOT: xtimer, thread, mutex, shell, random, luid, fmt
+ * - NimBLE mesh: models and publication, access, lower transport with
+ *   segmentation, network layer with relay and message cache, advertising
+ *   buffers
+ * - mystats and myfilter of the NimBLE fork
+ *
+ * Stack limits use the MYNEWT_VAL() settings of ../../fw/Makefile.mesh with
+ * the NimBLE defaults otherwise.
+ *
+ * @}
+ */
+
+#ifndef HOST_H
+#define HOST_H
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ---- RIOT --------------------------------------------------------------- */
+
+#define US_PER_SEC              (1000000U)
+#define US_PER_MS               (1000U)
+
+#ifndef ARRAY_SIZE
+#define ARRAY_SIZE(a)           (sizeof((a)) / sizeof((a)[0]))
+#endif
+
+/* like RIOT's assert() with DEVELHELP: print and halt the node */
+void host_assert_failure(const char *file, unsigned line);
+#define assert(cond)            ((cond) ? (void)0 \
+                                        : host_assert_failure(__FILE__, __LINE__))
+
+unsigned irq_disable(void);
+void irq_restore(unsigned state);
+
+typedef struct {
+    int locked;
+} mutex_t;
+
+#define MUTEX_INIT              { 0 }
+
+void mutex_lock(mutex_t *mutex);
+void mutex_unlock(mutex_t *mutex);
+
+typedef int16_t kernel_pid_t;
+
+#define MAXTHREADS              (8)
+#define KERNEL_PID_UNDEF        (0)
+#define KERNEL_PID_FIRST        (KERNEL_PID_UNDEF + 1)
+#define KERNEL_PID_LAST         (KERNEL_PID_FIRST + MAXTHREADS - 1)
+
+#define THREAD_CREATE_STACKTEST (8)
+#define THREAD_STACKSIZE_DEFAULT (1024)
+
+typedef struct {
+    char *stack_start;
+    int stack_size;
+    const char *name;
+} thread_t;
+
+typedef struct {
+    uint32_t laststart;
+    unsigned schedules;
+    uint64_t runtime_ticks;
+} schedstat_t;
+
+extern volatile thread_t *sched_threads[KERNEL_PID_LAST + 1];
+extern schedstat_t sched_pidlist[KERNEL_PID_LAST + 1];
+
+/* threads other than main are registered but not run, the mesh stack is
+ * driven by the simulator's event loop */
+kernel_pid_t thread_create(char *stack, int stacksize, uint8_t priority,
+                           int flags, void *(*task_func)(void *), void *arg,
+                           const char *name);
+kernel_pid_t thread_getpid(void);
+const char *thread_getname(kernel_pid_t pid);
+uintptr_t thread_measure_stack_free(char *stack);
+
+typedef struct {
+    uint32_t ticks32;
+} xtimer_ticks32_t;
+
+typedef struct {
+    uint64_t ticks64;
+} xtimer_ticks64_t;
+
+uint32_t xtimer_now_usec(void);
+xtimer_ticks32_t xtimer_now(void);
+xtimer_ticks64_t xtimer_now64(void);
+void xtimer_usleep(uint32_t us);
+void xtimer_periodic_wakeup(xtimer_ticks32_t *last_wakeup, uint32_t period);
+
+static inline uint32_t xtimer_usec_from_ticks(xtimer_ticks32_t ticks)
+{
+    return ticks.ticks32;
+}
+
+static inline uint64_t xtimer_usec_from_ticks64(uint64_t ticks)
+{
+    return ticks;
+}
+
+#define SHELL_DEFAULT_BUFSIZE   (128)
+
+typedef int (*shell_command_handler_t)(int argc, char **argv);
+
+typedef struct shell_command_t {
+    const char *name;
+    const char *desc;
+    shell_command_handler_t handler;
+} shell_command_t;
+
+void shell_run(const shell_command_t *commands, char *line_buf, int len);
+
+uint32_t random_uint32_range(uint32_t a, uint32_t b);
+void luid_get(void *buf, size_t len);
+size_t fmt_strlen(const char *str);
+size_t fmt_hex_bytes(uint8_t *out, const char *hex);
+
+/* ---- NimBLE ------------------------------------------------------------- */
+
+typedef uint8_t u8_t;
+typedef uint16_t u16_t;
+typedef uint32_t u32_t;
+typedef int8_t s8_t;
+
+#define MYNEWT_VAL(x)                       MYNEWT_VAL_ ## x
+
+#ifndef MYNEWT_VAL_BLE_MESH_DEV_UUID
+#define MYNEWT_VAL_BLE_MESH_DEV_UUID        { 0x11, 0x22 }
+#endif
+#ifndef MYNEWT_VAL_BLE_MESH_ADV_BUF_COUNT
+#define MYNEWT_VAL_BLE_MESH_ADV_BUF_COUNT   (20)
+#endif
+#ifndef MYNEWT_VAL_BLE_MESH_MSG_CACHE_SIZE
+#define MYNEWT_VAL_BLE_MESH_MSG_CACHE_SIZE  (10)
+#endif
+#ifndef MYNEWT_VAL_BLE_MESH_APP_KEY_COUNT
+#define MYNEWT_VAL_BLE_MESH_APP_KEY_COUNT   (1)
+#endif
+#ifndef MYNEWT_VAL_BLE_MESH_MODEL_KEY_COUNT
+#define MYNEWT_VAL_BLE_MESH_MODEL_KEY_COUNT (1)
+#endif
+#ifndef MYNEWT_VAL_BLE_MESH_MODEL_GROUP_COUNT
+#define MYNEWT_VAL_BLE_MESH_MODEL_GROUP_COUNT (1)
+#endif
+#ifndef MYNEWT_VAL_BLE_MESH_TX_SEG_MSG_COUNT
+#define MYNEWT_VAL_BLE_MESH_TX_SEG_MSG_COUNT (4)
+#endif
+#ifndef MYNEWT_VAL_BLE_MESH_RX_SEG_MSG_COUNT
+#define MYNEWT_VAL_BLE_MESH_RX_SEG_MSG_COUNT (2)
+#endif
+#ifndef MYNEWT_VAL_BLE_MESH_TX_SEG_MAX
+#define MYNEWT_VAL_BLE_MESH_TX_SEG_MAX      (3)
+#endif
+#ifndef MYNEWT_VAL_BLE_MESH_RX_SEG_MAX
+#define MYNEWT_VAL_BLE_MESH_RX_SEG_MAX      (3)
+#endif
+#ifndef MYNEWT_VAL_BLE_MESH_RX_SDU_MAX
+#define MYNEWT_VAL_BLE_MESH_RX_SDU_MAX      (72)
+#endif
+
+#define NIMBLE_MESH_STACKSIZE   (THREAD_STACKSIZE_DEFAULT)
+#define NIMBLE_MESH_PRIO        (3)
+
+extern uint8_t nimble_riot_own_addr_type;
+
+void mesh_adv_thread(void *arg);
+
+/* mbufs are single buffers with headroom for the network header */
+struct bt_mesh_adv {
+    const struct bt_mesh_send_cb *cb;
+    void *cb_data;
+    u8_t type:2,
+         busy:1;
+    u8_t xmit;
+};
+
+struct os_mbuf {
+    uint8_t *om_data;
+    uint16_t om_len;
+    uint16_t om_size;
+    struct bt_mesh_adv om_adv;
+    int om_ref;
+    uint8_t om_databuf[];
+};
+
+#define BT_MESH_ADV(om)         (&(om)->om_adv)
+#define NET_BUF_SIMPLE(size)    host_mbuf_alloc((size), 0)
+
+struct os_mbuf *host_mbuf_alloc(uint16_t size, uint16_t headroom);
+void os_mbuf_free_chain(struct os_mbuf *om);
+
+void net_buf_simple_init(struct os_mbuf *buf, size_t reserve_head);
+void *net_buf_simple_add(struct os_mbuf *buf, size_t len);
+void net_buf_simple_add_mem(struct os_mbuf *buf, const void *mem, size_t len);
+void net_buf_simple_add_u8(struct os_mbuf *buf, u8_t val);
+void net_buf_simple_add_le16(struct os_mbuf *buf, u16_t val);
+void net_buf_simple_add_be16(struct os_mbuf *buf, u16_t val);
+void *net_buf_simple_push(struct os_mbuf *buf, size_t len);
+void *net_buf_simple_pull(struct os_mbuf *buf, size_t len);
+u8_t net_buf_simple_pull_u8(struct os_mbuf *buf);
+u16_t net_buf_simple_pull_le16(struct os_mbuf *buf);
+u16_t net_buf_simple_pull_be16(struct os_mbuf *buf);
+
+struct os_mempool {
+    const char *name;
+    int blocks;
+    int free;
+    int min_free;
+    int block_size;
+};
+
+#define OS_MEMPOOL_INFO_NAME_LEN (32)
+
+struct os_mempool_info {
+    int omi_block_size;
+    int omi_num_blocks;
+    int omi_num_free;
+    int omi_min_free;
+    char omi_name[OS_MEMPOOL_INFO_NAME_LEN];
+};
+
+struct os_mempool *os_mempool_info_get_next(struct os_mempool *mp,
+                                            struct os_mempool_info *omi);
+
+/* mesh addresses, keys and states */
+#define BT_MESH_ADDR_UNASSIGNED         (0x0000)
+#define BT_MESH_ADDR_ALL_NODES          (0xffff)
+#define BT_MESH_ADDR_IS_UNICAST(addr)   ((addr) && (addr) < 0x8000)
+#define BT_MESH_ADDR_IS_GROUP(addr)     ((addr) >= 0xc000 && (addr) <= 0xff00)
+#define BT_MESH_KEY_UNUSED              (0xffff)
+#define BT_MESH_TTL_DEFAULT             (0xff)
+#define BT_MESH_NET_HDR_LEN             (9)
+
+#define BT_MESH_RELAY_DISABLED          (0x00)
+#define BT_MESH_RELAY_ENABLED           (0x01)
+#define BT_MESH_BEACON_DISABLED         (0x00)
+#define BT_MESH_GATT_PROXY_NOT_SUPPORTED (0x02)
+#define BT_MESH_FRIEND_NOT_SUPPORTED    (0x02)
+
+#define BT_MESH_TRANSMIT(count, int_ms) ((count) | ((((int_ms) / 10) - 1) << 3))
+#define BT_MESH_TRANSMIT_COUNT(transmit) (((transmit) & (u8_t)0x07))
+#define BT_MESH_TRANSMIT_INT(transmit)  ((((transmit) >> 3) + 1) * 10)
+
+#define BT_MESH_MODEL_ID_CFG_SRV        (0x0000)
+#define BT_MESH_MODEL_ID_CFG_CLI        (0x0001)
+#define BT_MESH_MODEL_ID_GEN_ONOFF_SRV  (0x1000)
+#define BT_MESH_MODEL_ID_GEN_ONOFF_CLI  (0x1001)
+#define BT_MESH_MODEL_ID_GEN_LEVEL_SRV  (0x1002)
+#define BT_MESH_MODEL_ID_GEN_LEVEL_CLI  (0x1003)
+
+#define BT_MESH_MODEL_OP_1(b0)          (b0)
+#define BT_MESH_MODEL_OP_2(b0, b1)      (((b0) << 8) | (b1))
+#define BT_MESH_MODEL_OP_3(b0, cid)     ((((b0) << 16) | 0xc00000) | (cid))
+
+struct bt_mesh_msg_ctx {
+    u16_t net_idx;
+    u16_t app_idx;
+    u16_t addr;
+    u16_t recv_dst;
+    u8_t recv_ttl:7;
+    u8_t send_rel:1;
+    u8_t send_ttl;
+};
+
+struct bt_mesh_model;
+
+struct bt_mesh_model_op {
+    const u32_t opcode;
+    const size_t min_len;
+    void (*const func)(struct bt_mesh_model *model,
+                       struct bt_mesh_msg_ctx *ctx, struct os_mbuf *buf);
+};
+
+#define BT_MESH_MODEL_OP_END            { 0, 0, NULL }
+
+struct bt_mesh_model_pub {
+    struct bt_mesh_model *mod;
+    u16_t addr;
+    u16_t key;
+    u8_t ttl;
+    u8_t retransmit;
+    u8_t period;
+    u8_t cred:1;
+    struct os_mbuf *msg;
+};
+
+struct bt_mesh_model {
+    u16_t id;
+    u16_t cid;
+    bool vnd;
+    u8_t elem_idx;
+    u8_t mod_idx;
+    struct bt_mesh_model_pub *const pub;
+    u16_t keys[MYNEWT_VAL(BLE_MESH_MODEL_KEY_COUNT)];
+    u16_t groups[MYNEWT_VAL(BLE_MESH_MODEL_GROUP_COUNT)];
+    const struct bt_mesh_model_op *const op;
+    void *user_data;
+};
+
+#define BT_MESH_MODEL(_id, _op, _pub, _user_data)                   \
+{                                                                   \
+    .id = (_id),                                                    \
+    .pub = _pub,                                                    \
+    .op = _op,                                                      \
+    .user_data = _user_data,                                        \
+}
+
+#define BT_MESH_MODEL_VND(_company, _id, _op, _pub, _user_data)     \
+{                                                                   \
+    .id = (_id),                                                    \
+    .cid = (_company),                                              \
+    .vnd = true,                                                    \
+    .pub = _pub,                                                    \
+    .op = _op,                                                      \
+    .user_data = _user_data,                                        \
+}
+
+#define BT_MESH_MODEL_NONE              ((struct bt_mesh_model []){})
+
+struct bt_mesh_elem {
+    u16_t addr;
+    const u16_t loc;
+    const u8_t model_count;
+    const u8_t vnd_model_count;
+    struct bt_mesh_model *const models;
+    struct bt_mesh_model *const vnd_models;
+};
+
+#define BT_MESH_ELEM(_loc, _mods, _vnd_mods)                        \
+{                                                                   \
+    .loc = (_loc),                                                  \
+    .model_count = ARRAY_SIZE(_mods),                               \
+    .vnd_model_count = ARRAY_SIZE(_vnd_mods),                       \
+    .models = (_mods),                                              \
+    .vnd_models = (_vnd_mods),                                      \
+}
+
+struct bt_mesh_comp {
+    u16_t cid;
+    u16_t pid;
+    u16_t vid;
+    size_t elem_count;
+    struct bt_mesh_elem *elem;
+};
+
+struct bt_mesh_prov {
+    const u8_t *uuid;
+    u8_t output_size;
+    u16_t output_actions;
+    void (*complete)(u16_t net_idx, u16_t addr);
+    void (*reset)(void);
+};
+
+struct bt_mesh_cfg_srv {
+    struct bt_mesh_model *model;
+    u8_t net_transmit;
+    u8_t relay;
+    u8_t relay_retransmit;
+    u8_t beacon;
+    u8_t gatt_proxy;
+    u8_t frnd;
+    u8_t default_ttl;
+};
+
+struct bt_mesh_cfg_cli {
+    struct bt_mesh_model *model;
+};
+
+#define BT_MESH_MODEL_CFG_SRV(srv_data)                             \
+    BT_MESH_MODEL(BT_MESH_MODEL_ID_CFG_SRV, NULL, NULL, srv_data)
+#define BT_MESH_MODEL_CFG_CLI(cli_data)                             \
+    BT_MESH_MODEL(BT_MESH_MODEL_ID_CFG_CLI, NULL, NULL, cli_data)
+
+struct bt_mesh_cfg_mod_pub {
+    u16_t addr;
+    u16_t app_idx;
+    bool cred_flag;
+    u8_t ttl;
+    u8_t period;
+    u8_t transmit;
+};
+
+struct bt_mesh_send_cb {
+    void (*start)(u16_t duration, int err, void *cb_data);
+    void (*end)(int err, void *cb_data);
+};
+
+int bt_mesh_init(u8_t own_addr_type, const struct bt_mesh_prov *prov,
+                 const struct bt_mesh_comp *comp);
+int bt_mesh_provision(const u8_t net_key[16], u16_t net_idx, u8_t flags,
+                      u32_t iv_index, u16_t addr, const u8_t dev_key[16]);
+void bt_mesh_model_msg_init(struct os_mbuf *msg, u32_t opcode);
+int bt_mesh_model_send(struct bt_mesh_model *model,
+                       struct bt_mesh_msg_ctx *ctx, struct os_mbuf *msg,
+                       const struct bt_mesh_send_cb *cb, void *cb_data);
+int bt_mesh_model_publish(struct bt_mesh_model *model);
+
+u8_t bt_mesh_net_transmit_get(void);
+u8_t bt_mesh_relay_retransmit_get(void);
+u8_t bt_mesh_relay_get(void);
+
+/* the configuration client only configures the local node, without the
+ * round trip through the access layer */
+int bt_mesh_cfg_mod_app_bind(u16_t net_idx, u16_t addr, u16_t elem_addr,
+                             u16_t mod_app_idx, u16_t mod_id, u8_t *status);
+int bt_mesh_cfg_mod_app_bind_vnd(u16_t net_idx, u16_t addr, u16_t elem_addr,
+                                 u16_t mod_app_idx, u16_t mod_id, u16_t cid,
+                                 u8_t *status);
+int bt_mesh_cfg_mod_pub_set(u16_t net_idx, u16_t addr, u16_t elem_addr,
+                            u16_t mod_id, struct bt_mesh_cfg_mod_pub *pub,
+                            u8_t *status);
+int bt_mesh_cfg_mod_pub_set_vnd(u16_t net_idx, u16_t addr, u16_t elem_addr,
+                                u16_t mod_id, u16_t cid,
+                                struct bt_mesh_cfg_mod_pub *pub, u8_t *status);
+int bt_mesh_cfg_mod_sub_add(u16_t net_idx, u16_t addr, u16_t elem_addr,
+                            u16_t sub_addr, u16_t mod_id, u8_t *status);
+int bt_mesh_cfg_mod_sub_add_vnd(u16_t net_idx, u16_t addr, u16_t elem_addr,
+                                u16_t sub_addr, u16_t mod_id, u16_t cid,
+                                u8_t *status);
+
+/* internal state of the stack (net.h, crypto.h) */
+struct bt_mesh_app_keys {
+    u8_t id;
+    u8_t val[16];
+};
+
+struct bt_mesh_app_key {
+    u16_t net_idx;
+    u16_t app_idx;
+    bool updated;
+    struct bt_mesh_app_keys keys[2];
+};
+
+struct bt_mesh_subnet {
+    u16_t net_idx;
+};
+
+struct bt_mesh_net {
+    u32_t iv_index;
+    u32_t seq;
+    bool provisioned;
+    u16_t addr;
+    struct bt_mesh_subnet sub;
+    struct bt_mesh_app_key app_keys[MYNEWT_VAL(BLE_MESH_APP_KEY_COUNT)];
+};
+
+extern struct bt_mesh_net bt_mesh;
+
+struct bt_mesh_net_tx {
+    struct bt_mesh_subnet *sub;
+    struct bt_mesh_msg_ctx *ctx;
+    u16_t src;
+    u8_t xmit;
+};
+
+struct bt_mesh_net_rx {
+    struct bt_mesh_subnet *sub;
+    struct bt_mesh_msg_ctx ctx;
+    u32_t seq;
+    u8_t ctl:1,
+         local_match:1;
+};
+
+int bt_mesh_app_id(const u8_t app_key[16], u8_t *app_id);
+
+int bt_mesh_net_send(struct bt_mesh_net_tx *tx, struct os_mbuf *buf,
+                     const struct bt_mesh_send_cb *cb, void *cb_data);
+int bt_mesh_net_resend(struct bt_mesh_subnet *sub, struct os_mbuf *buf,
+                       bool new_key, const struct bt_mesh_send_cb *cb,
+                       void *cb_data);
+int bt_mesh_trans_recv(struct os_mbuf *buf, struct bt_mesh_net_rx *rx);
+void bt_mesh_adv_send(struct os_mbuf *buf, const struct bt_mesh_send_cb *cb,
+                      void *cb_data);
+
+/* ---- mystats and myfilter ----------------------------------------------- */
+
+void mystats_enable(void);
+void mystats_clear(void);
+void mystats_dump(void);
+void mystats_inc_tx_app(const char *op, unsigned val);
+void mystats_inc_rx_app(const char *op, unsigned val);
+
+int myfilter_add_str(const char *addr);
+
+/* ---- internal to the host layer ----------------------------------------- */
+
+int bt_mesh_trans_send(struct bt_mesh_net_tx *tx, const u8_t *sdu, size_t len,
+                       const struct bt_mesh_send_cb *cb, void *cb_data);
+void host_access_recv(struct bt_mesh_msg_ctx *ctx, const u8_t *data,
+                      size_t len);
+struct bt_mesh_elem *host_elem_find(u16_t addr);
+struct bt_mesh_model *host_model_find(struct bt_mesh_elem *elem, u16_t id,
+                                      u16_t cid, bool vnd);
+bool host_group_subscribed(u16_t addr);
+u8_t host_default_ttl(void);
+struct os_mbuf *host_adv_create(u8_t xmit);
+void host_adv_unref(struct os_mbuf *buf);
+void host_net_recv(const uint8_t *data, size_t len);
+bool host_filter_accepts(const uint8_t *adv_addr);
+
+/* code run by the core outside of the main thread belongs to the mesh
+ * thread, entry points switch to its PID and back */
+kernel_pid_t host_pid_enter(void);
+void host_pid_leave(kernel_pid_t pid);
+
+/* entry points for the core, see sim.h */
+void host_rx(const uint8_t *data, size_t len, const uint8_t *adv_addr);
+void host_adv_cb(void *ref, int done);
+int host_is_sink(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_H */
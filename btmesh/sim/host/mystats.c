@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2019 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Host versions of mystats and myfilter of the NimBLE fork
+ *
+ * Every counted application message is logged as `tx app <op> <value>` or
+ * `rx app <op> <value>`, the format tools/analyzer matches on.
+ *
+ * The advertiser filter takes BLE addresses like the firmware's, or node
+ * names (e.g. nrf52dk-3), which the core resolves to the simulated address
+ * of that node.
+ *
+ * @}
+ */
+
+#include <string.h>
+
+#include "host.h"
+#include "sim.h"
+
+#define FILTER_MAX              (8U)
+
+static bool _enabled = false;
+static unsigned _tx_app = 0;
+static unsigned _rx_app = 0;
+
+static uint8_t _filter[FILTER_MAX][SIM_BLE_ADDR_LEN];
+static unsigned _filter_len = 0;
+
+void mystats_enable(void)
+{
+    _enabled = true;
+}
+
+void mystats_clear(void)
+{
+    _tx_app = 0;
+    _rx_app = 0;
+}
+
+void mystats_dump(void)
+{
+    printf("mystats tx app: %u\n", _tx_app);
+    printf("mystats rx app: %u\n", _rx_app);
+}
+
+void mystats_inc_tx_app(const char *op, unsigned val)
+{
+    if (!_enabled) {
+        return;
+    }
+    _tx_app++;
+    sim_stat_app(1);
+    printf("tx app %s %u\n", op, val);
+}
+
+void mystats_inc_rx_app(const char *op, unsigned val)
+{
+    if (!_enabled) {
+        return;
+    }
+    _rx_app++;
+    sim_stat_app(0);
+    printf("rx app %s %u\n", op, val);
+}
+
+int myfilter_add_str(const char *addr)
+{
+    uint8_t val[SIM_BLE_ADDR_LEN];
+
+    if (_filter_len == FILTER_MAX) {
+        return -ENOMEM;
+    }
+    if (strchr(addr, '-') != NULL) {
+        if (sim_ble_addr_of(addr, val) != 0) {
+            return -EINVAL;
+        }
+    }
+    else if ((strlen(addr) != (2 * SIM_BLE_ADDR_LEN)) ||
+             (fmt_hex_bytes(val, addr) != SIM_BLE_ADDR_LEN)) {
+        return -EINVAL;
+    }
+    memcpy(_filter[_filter_len++], val, SIM_BLE_ADDR_LEN);
+    return 0;
+}
+
+bool host_filter_accepts(const uint8_t *adv_addr)
+{
+    if (_filter_len == 0) {
+        return true;
+    }
+    for (unsigned i = 0; i < _filter_len; i++) {
+        if (memcmp(_filter[i], adv_addr, SIM_BLE_ADDR_LEN) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2019 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Host network layer: header, message cache and relaying
+ *
+ * Network PDUs have the layout and length of real ones, but are neither
+ * obfuscated nor encrypted, the NetMIC is zero filled.
+ *
+ * @}
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "host.h"
+#include "sim.h"
+
+#define NET_MIC_LEN(ctl)        ((ctl) ? 8U : 4U)
+#define NET_CACHE_SIZE          MYNEWT_VAL(BLE_MESH_MSG_CACHE_SIZE)
+
+static struct {
+    u16_t src;
+    u32_t seq;
+} _cache[NET_CACHE_SIZE];
+static unsigned _cache_next = 0;
+
+/* the network message cache is a FIFO of (src, seq), like NimBLE's hash of
+ * IV index, SEQ and SRC */
+static bool _cache_check_add(u16_t src, u32_t seq)
+{
+    for (unsigned i = 0; i < NET_CACHE_SIZE; i++) {
+        if ((_cache[i].src == src) && (_cache[i].seq == seq)) {
+            return true;
+        }
+    }
+    _cache[_cache_next].src = src;
+    _cache[_cache_next].seq = seq;
+    _cache_next = (_cache_next + 1) % NET_CACHE_SIZE;
+    return false;
+}
+
+int bt_mesh_net_send(struct bt_mesh_net_tx *tx, struct os_mbuf *buf,
+                     const struct bt_mesh_send_cb *cb, void *cb_data)
+{
+    bool ctl = (tx->ctx->app_idx == BT_MESH_KEY_UNUSED);
+    u8_t ttl = tx->ctx->send_ttl;
+    if (ttl == BT_MESH_TTL_DEFAULT) {
+        ttl = host_default_ttl();
+    }
+
+    u32_t seq = bt_mesh.seq++;
+    u8_t *hdr = net_buf_simple_push(buf, BT_MESH_NET_HDR_LEN);
+    hdr[0] = (u8_t)((bt_mesh.iv_index & 0x01) << 7);
+    hdr[1] = (u8_t)((ctl ? 0x80 : 0x00) | (ttl & 0x7f));
+    hdr[2] = (u8_t)(seq >> 16);
+    hdr[3] = (u8_t)(seq >> 8);
+    hdr[4] = (u8_t)seq;
+    hdr[5] = (u8_t)(tx->src >> 8);
+    hdr[6] = (u8_t)tx->src;
+    hdr[7] = (u8_t)(tx->ctx->addr >> 8);
+    hdr[8] = (u8_t)tx->ctx->addr;
+    memset(net_buf_simple_add(buf, NET_MIC_LEN(ctl)), 0, NET_MIC_LEN(ctl));
+
+    /* like in NimBLE, this consumes the caller's reference to buf */
+    bt_mesh_adv_send(buf, cb, cb_data);
+    host_adv_unref(buf);
+    return 0;
+}
+
+int bt_mesh_net_resend(struct bt_mesh_subnet *sub, struct os_mbuf *buf,
+                       bool new_key, const struct bt_mesh_send_cb *cb,
+                       void *cb_data)
+{
+    (void)sub;
+    (void)new_key;
+
+    /* the PDU is sent again as is, with its original sequence number */
+    bt_mesh_adv_send(buf, cb, cb_data);
+    return 0;
+}
+
+static void _relay(const uint8_t *data, size_t len, u8_t ttl)
+{
+    if ((bt_mesh_relay_get() != BT_MESH_RELAY_ENABLED) || (ttl <= 1)) {
+        return;
+    }
+
+    struct os_mbuf *buf = host_adv_create(bt_mesh_relay_retransmit_get());
+    if (buf == NULL) {
+        /* out of relay buffers */
+        sim_stat_relay_drop();
+        return;
+    }
+    net_buf_simple_add_mem(buf, data, len);
+    buf->om_data[1] = (u8_t)((data[1] & 0x80) | (ttl - 1));
+    bt_mesh_adv_send(buf, NULL, NULL);
+    host_adv_unref(buf);
+}
+
+void host_net_recv(const uint8_t *data, size_t len)
+{
+    if (!bt_mesh.provisioned || (len < (BT_MESH_NET_HDR_LEN + 1 + 4))) {
+        return;
+    }
+
+    bool ctl = (data[1] & 0x80);
+    u8_t ttl = data[1] & 0x7f;
+    u32_t seq = ((u32_t)data[2] << 16) | ((u32_t)data[3] << 8) | data[4];
+    u16_t src = (u16_t)((data[5] << 8) | data[6]);
+    u16_t dst = (u16_t)((data[7] << 8) | data[8]);
+
+    if ((len < (BT_MESH_NET_HDR_LEN + 1 + NET_MIC_LEN(ctl))) ||
+        !BT_MESH_ADDR_IS_UNICAST(src) || (dst == BT_MESH_ADDR_UNASSIGNED)) {
+        return;
+    }
+    if (_cache_check_add(src, seq)) {
+        return;
+    }
+    /* drop locally originated PDUs */
+    if (host_elem_find(src) != NULL) {
+        return;
+    }
+
+    struct bt_mesh_net_rx rx = {
+        .sub = &bt_mesh.sub,
+        .ctx = {
+            .net_idx = bt_mesh.sub.net_idx,
+            .app_idx = BT_MESH_KEY_UNUSED,
+            .addr = src,
+            .recv_dst = dst,
+            .recv_ttl = ttl,
+            .send_ttl = BT_MESH_TTL_DEFAULT,
+        },
+        .seq = seq,
+        .ctl = ctl,
+    };
+    rx.local_match = ((host_elem_find(dst) != NULL) ||
+                      (dst == BT_MESH_ADDR_ALL_NODES) ||
+                      host_group_subscribed(dst));
+
+    if (rx.local_match) {
+        size_t pdu_len = len - NET_MIC_LEN(ctl);
+        struct os_mbuf *buf = host_mbuf_alloc((uint16_t)pdu_len, 0);
+        net_buf_simple_add_mem(buf, data, pdu_len);
+        bt_mesh_trans_recv(buf, &rx);
+        os_mbuf_free_chain(buf);
+    }
+
+    /* relay group messages and unicast messages that are not for us */
+    if (!BT_MESH_ADDR_IS_UNICAST(dst) || !rx.local_match) {
+        _relay(data, len, ttl);
+    }
+}
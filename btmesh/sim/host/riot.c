@@ -0,0 +1,331 @@
+/*
+ * Copyright (C) 2019 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Host RIOT layer: stdio, shell, threads, mutex and xtimer
+ *
+ * The firmware's main thread runs in a coroutine of the simulator core, all
+ * blocking calls (xtimer sleeps, mutex_lock() and reading shell input) hand
+ * control back to the core until the node is resumed.
+ *
+ * @}
+ */
+
+#include <stdarg.h>
+#include <string.h>
+
+#include "host.h"
+#include "sim.h"
+
+#define LINE_MAX_LEN            (256U)
+#define SHELL_ARGS_MAX          (16U)
+
+#define PID_MAIN                (KERNEL_PID_FIRST)
+
+static char _line[LINE_MAX_LEN];
+static size_t _line_len = 0;
+
+static thread_t _threads[KERNEL_PID_LAST + 1];
+static kernel_pid_t _pid_next = PID_MAIN + 1;
+static kernel_pid_t _pid_mesh = PID_MAIN;
+static kernel_pid_t _pid = PID_MAIN;
+
+volatile thread_t *sched_threads[KERNEL_PID_LAST + 1];
+schedstat_t sched_pidlist[KERNEL_PID_LAST + 1];
+
+/* ---- stdio -------------------------------------------------------------- */
+
+/* output is collected per line, every line is logged by the core with the
+ * time and the name of the node, like serial_aggregator does */
+static void _out_char(char c)
+{
+    if (c == '\n') {
+        _line[_line_len] = '\0';
+        sim_out(_line);
+        _line_len = 0;
+    }
+    else if (_line_len < (LINE_MAX_LEN - 1)) {
+        _line[_line_len++] = c;
+    }
+}
+
+int printf(const char *format, ...)
+{
+    char buf[LINE_MAX_LEN * 2];
+    va_list ap;
+
+    va_start(ap, format);
+    int res = vsnprintf(buf, sizeof(buf), format, ap);
+    va_end(ap);
+    for (const char *c = buf; *c; c++) {
+        _out_char(*c);
+    }
+    return res;
+}
+
+int puts(const char *str)
+{
+    while (*str) {
+        _out_char(*str++);
+    }
+    _out_char('\n');
+    return 1;
+}
+
+int putchar(int c)
+{
+    _out_char((char)c);
+    return c;
+}
+
+void host_assert_failure(const char *file, unsigned line)
+{
+    printf("%s:%u => FAILED ASSERTION.\n", file, line);
+    puts("*** RIOT kernel panic:\nFAILED ASSERTION.");
+    sim_halt();
+}
+
+/* ---- threads ------------------------------------------------------------ */
+
+unsigned irq_disable(void)
+{
+    return 0;
+}
+
+void irq_restore(unsigned state)
+{
+    (void)state;
+}
+
+void mutex_lock(mutex_t *mutex)
+{
+    while (mutex->locked) {
+        sim_block();
+    }
+    mutex->locked = 1;
+}
+
+void mutex_unlock(mutex_t *mutex)
+{
+    mutex->locked = 0;
+    sim_wake();
+}
+
+static void _stack_paint(char *stack, int size)
+{
+    /* same pattern as RIOT's stack test: every word holds its address */
+    uintptr_t *p = (uintptr_t *)stack;
+    uintptr_t *end = (uintptr_t *)(stack + size);
+    while (p < end) {
+        *p = (uintptr_t)p;
+        p++;
+    }
+}
+
+static void _thread_init(void)
+{
+    if (sched_threads[PID_MAIN] != NULL) {
+        return;
+    }
+    /* the core paints the stack of the main thread */
+    sim_stack(&_threads[PID_MAIN].stack_start, &_threads[PID_MAIN].stack_size);
+    _threads[PID_MAIN].name = "main";
+    sched_threads[PID_MAIN] = &_threads[PID_MAIN];
+}
+
+kernel_pid_t thread_create(char *stack, int stacksize, uint8_t priority,
+                           int flags, void *(*task_func)(void *), void *arg,
+                           const char *name)
+{
+    (void)priority;
+    (void)task_func;
+    (void)arg;
+
+    _thread_init();
+    if (_pid_next > KERNEL_PID_LAST) {
+        return -EOVERFLOW;
+    }
+    kernel_pid_t pid = _pid_next++;
+    if (flags & THREAD_CREATE_STACKTEST) {
+        _stack_paint(stack, stacksize);
+    }
+    _threads[pid].stack_start = stack;
+    _threads[pid].stack_size = stacksize;
+    _threads[pid].name = name;
+    sched_threads[pid] = &_threads[pid];
+    /* everything the core runs outside of the main thread belongs to the
+     * mesh stack, the first thread created is the mesh thread */
+    if (_pid_mesh == PID_MAIN) {
+        _pid_mesh = pid;
+    }
+    return pid;
+}
+
+kernel_pid_t thread_getpid(void)
+{
+    return _pid;
+}
+
+const char *thread_getname(kernel_pid_t pid)
+{
+    _thread_init();
+    return (sched_threads[pid] != NULL) ? sched_threads[pid]->name : NULL;
+}
+
+uintptr_t thread_measure_stack_free(char *stack)
+{
+    uintptr_t *p = (uintptr_t *)stack;
+    while (*p == (uintptr_t)p) {
+        p++;
+    }
+    return (uintptr_t)p - (uintptr_t)stack;
+}
+
+kernel_pid_t host_pid_enter(void)
+{
+    kernel_pid_t pid = _pid;
+    _pid = _pid_mesh;
+    return pid;
+}
+
+void host_pid_leave(kernel_pid_t pid)
+{
+    _pid = pid;
+}
+
+/* ---- xtimer ------------------------------------------------------------- */
+
+uint32_t xtimer_now_usec(void)
+{
+    return (uint32_t)sim_now();
+}
+
+xtimer_ticks32_t xtimer_now(void)
+{
+    xtimer_ticks32_t now = { (uint32_t)sim_now() };
+    return now;
+}
+
+xtimer_ticks64_t xtimer_now64(void)
+{
+    xtimer_ticks64_t now = { sim_now() };
+    return now;
+}
+
+void xtimer_usleep(uint32_t us)
+{
+    sim_sleep_until(sim_now() + us);
+}
+
+void xtimer_periodic_wakeup(xtimer_ticks32_t *last_wakeup, uint32_t period)
+{
+    uint32_t target = last_wakeup->ticks32 + period;
+    int32_t left = (int32_t)(target - (uint32_t)sim_now());
+
+    if (left > 0) {
+        sim_sleep_until(sim_now() + (uint32_t)left);
+    }
+    last_wakeup->ticks32 = target;
+}
+
+/* ---- shell -------------------------------------------------------------- */
+
+static void _shell_help(const shell_command_t *commands)
+{
+    puts("Command              Description");
+    puts("---------------------------------------");
+    for (const shell_command_t *c = commands; c->name != NULL; c++) {
+        printf("%-20s %s\n", c->name, c->desc);
+    }
+    printf("%-20s %s\n", "reboot", "Reboot the node");
+}
+
+void shell_run(const shell_command_t *commands, char *line_buf, int len)
+{
+    char *argv[SHELL_ARGS_MAX];
+
+    _thread_init();
+    for (;;) {
+        sim_shell_read(line_buf, (size_t)len);
+        printf("> %s\n", line_buf);
+
+        int argc = 0;
+        char *tok = strtok(line_buf, " \t");
+        while (tok && (argc < (int)SHELL_ARGS_MAX)) {
+            argv[argc++] = tok;
+            tok = strtok(NULL, " \t");
+        }
+        if (argc == 0) {
+            continue;
+        }
+
+        const shell_command_t *cmd = commands;
+        while ((cmd->name != NULL) && (strcmp(cmd->name, argv[0]) != 0)) {
+            cmd++;
+        }
+        if (cmd->name != NULL) {
+            cmd->handler(argc, argv);
+        }
+        else if (strcmp(argv[0], "help") == 0) {
+            _shell_help(commands);
+        }
+        else if (strcmp(argv[0], "reboot") == 0) {
+            sim_reboot();
+        }
+        else {
+            printf("shell: command not found: %s\n", argv[0]);
+        }
+    }
+}
+
+/* ---- random, luid, fmt -------------------------------------------------- */
+
+uint32_t random_uint32_range(uint32_t a, uint32_t b)
+{
+    return (b > a) ? (a + (sim_rand() % (b - a))) : a;
+}
+
+/* the core hands out node unique IDs that yield non-overlapping unicast
+ * addresses, so unlike RIOT's luid_get() every call returns the same ID */
+void luid_get(void *buf, size_t len)
+{
+    sim_luid(buf, len);
+}
+
+size_t fmt_strlen(const char *str)
+{
+    return strlen(str);
+}
+
+static uint8_t _hex_nib(char c)
+{
+    if ((c >= '0') && (c <= '9')) {
+        return (uint8_t)(c - '0');
+    }
+    if ((c >= 'a') && (c <= 'f')) {
+        return (uint8_t)(c - 'a' + 10);
+    }
+    return (uint8_t)(c - 'A' + 10);
+}
+
+size_t fmt_hex_bytes(uint8_t *out, const char *hex)
+{
+    size_t len = fmt_strlen(hex);
+
+    if (len & 1) {
+        return 0;
+    }
+    for (size_t i = 0; i < (len / 2); i++) {
+        out[i] = (uint8_t)((_hex_nib(hex[2 * i]) << 4) |
+                           _hex_nib(hex[(2 * i) + 1]));
+    }
+    return len / 2;
+}
@@ -0,0 +1,510 @@
+/*
+ * Copyright (C) 2019 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Host lower transport layer: segmentation and reassembly
+ *
+ * Follows the segmentation of NimBLE's transport.c:
+ * - access messages longer than 11 bytes are split into segments of up to 12
+ *   bytes (including the 4 byte TransMIC), each in its own network PDU
+ * - unicast messages are acknowledged by the receiver, unacknowledged
+ *   segments are resent after 400ms + 50ms * TTL, up to 4 times before the
+ *   message fails with -ETIMEDOUT
+ * - group messages are resent 4 times and then end successfully
+ * - incomplete incoming messages are dropped after 10s
+ *
+ * @}
+ */
+
+#include <string.h>
+
+#include "host.h"
+#include "sim.h"
+
+#define TRANS_SEG_LEN           (12U)
+#define TRANS_UNSEG_LEN         (15U)
+#define TRANS_MIC_LEN           (4U)
+#define TRANS_SEG_HDR_LEN       (4U)
+#define TRANS_CTL_OP_ACK        (0x00)
+#define TRANS_AKF               (0x40)
+
+#define SEG_RETRANSMIT_ATTEMPTS (4U)
+#define SEG_RETRANSMIT_TIMEOUT(ttl) ((400U + (50U * (ttl))) * US_PER_MS)
+#define SEG_ACK_TIMEOUT(ttl)    ((150U + (50U * (ttl))) * US_PER_MS)
+#define SEG_RX_TIMEOUT          (10U * US_PER_SEC)
+#define SEG_RX_DONE_MAX         (8U)
+
+#define TX_SEG_MAX              MYNEWT_VAL(BLE_MESH_TX_SEG_MAX)
+#define RX_SEG_MAX              MYNEWT_VAL(BLE_MESH_RX_SEG_MAX)
+#define RX_SDU_MAX              MYNEWT_VAL(BLE_MESH_RX_SDU_MAX)
+#define BLOCK_COMPLETE(seg_n)   ((u32_t)(((u64_t)1 << ((seg_n) + 1)) - 1))
+
+typedef uint64_t u64_t;
+
+struct seg_tx {
+    struct os_mbuf *seg[TX_SEG_MAX];
+    struct bt_mesh_subnet *sub;
+    u16_t src;
+    u16_t dst;
+    u16_t seq_zero;
+    u8_t seg_n;
+    u8_t ttl;
+    u8_t attempts;
+    bool busy;
+    uint64_t timeout;           /* retransmit deadline, 0 if not running */
+    const struct bt_mesh_send_cb *cb;
+    void *cb_data;
+};
+
+struct seg_rx {
+    struct bt_mesh_msg_ctx ctx;
+    u16_t seq_zero;
+    u8_t seg_n;
+    bool busy;
+    u32_t block;
+    size_t len;
+    uint64_t ack_timeout;       /* ack deadline, 0 if not running */
+    uint64_t rx_timeout;
+    u8_t buf[RX_SDU_MAX];
+};
+
+static struct seg_tx _seg_tx[MYNEWT_VAL(BLE_MESH_TX_SEG_MSG_COUNT)];
+static struct seg_rx _seg_rx[MYNEWT_VAL(BLE_MESH_RX_SEG_MSG_COUNT)];
+
+/* recently completed incoming messages, duplicate segments of these are
+ * acknowledged again and dropped */
+static struct {
+    u16_t src;
+    u16_t seq_zero;
+} _rx_done[SEG_RX_DONE_MAX];
+static unsigned _rx_done_next = 0;
+
+static void _seg_sent(int err, void *cb_data);
+static void _seg_first_start(u16_t duration, int err, void *cb_data);
+
+static const struct bt_mesh_send_cb _seg_sent_cb = {
+    .end = _seg_sent,
+};
+
+static const struct bt_mesh_send_cb _seg_first_sent_cb = {
+    .start = _seg_first_start,
+    .end = _seg_sent,
+};
+
+/* ---- outgoing segmented messages ---------------------------------------- */
+
+static void _seg_tx_reset(struct seg_tx *tx)
+{
+    for (unsigned i = 0; i < TX_SEG_MAX; i++) {
+        if (tx->seg[i] != NULL) {
+            host_adv_unref(tx->seg[i]);
+            tx->seg[i] = NULL;
+        }
+    }
+    tx->timeout = 0;
+    tx->busy = false;
+}
+
+static void _seg_tx_complete(struct seg_tx *tx, int err)
+{
+    const struct bt_mesh_send_cb *cb = tx->cb;
+    void *cb_data = tx->cb_data;
+
+    _seg_tx_reset(tx);
+    if (cb && cb->end) {
+        cb->end(err, cb_data);
+    }
+}
+
+static void _seg_retransmit(void *arg);
+
+static void _seg_tx_timer_start(struct seg_tx *tx)
+{
+    tx->timeout = sim_now() + SEG_RETRANSMIT_TIMEOUT(tx->ttl);
+    sim_call_at(tx->timeout, _seg_retransmit, tx);
+}
+
+static void _seg_tx_send_unacked(struct seg_tx *tx)
+{
+    bool sent = false;
+
+    if (tx->attempts == 0) {
+        _seg_tx_complete(tx, BT_MESH_ADDR_IS_UNICAST(tx->dst) ? -ETIMEDOUT
+                                                              : 0);
+        return;
+    }
+    tx->attempts--;
+
+    for (unsigned i = 0; i <= tx->seg_n; i++) {
+        struct os_mbuf *seg = tx->seg[i];
+        /* skip acknowledged segments and those still being advertised */
+        if ((seg == NULL) || BT_MESH_ADV(seg)->busy) {
+            continue;
+        }
+        bt_mesh_net_resend(tx->sub, seg, false, &_seg_sent_cb, tx);
+        sent = true;
+    }
+    if (!sent) {
+        _seg_tx_timer_start(tx);
+    }
+}
+
+static void _seg_retransmit(void *arg)
+{
+    struct seg_tx *tx = arg;
+
+    if (!tx->busy || (tx->timeout != sim_now())) {
+        return;
+    }
+    tx->timeout = 0;
+    kernel_pid_t pid = host_pid_enter();
+    _seg_tx_send_unacked(tx);
+    host_pid_leave(pid);
+}
+
+static void _seg_first_start(u16_t duration, int err, void *cb_data)
+{
+    struct seg_tx *tx = cb_data;
+
+    if (tx->busy && tx->cb && tx->cb->start) {
+        tx->cb->start(duration, err, tx->cb_data);
+    }
+}
+
+static void _seg_sent(int err, void *cb_data)
+{
+    struct seg_tx *tx = cb_data;
+    (void)err;
+
+    /* (re)started by every segment, so it runs from the last one on */
+    if (tx->busy) {
+        _seg_tx_timer_start(tx);
+    }
+}
+
+static int _send_seg(struct bt_mesh_net_tx *net_tx, const u8_t *sdu,
+                     size_t len, const struct bt_mesh_send_cb *cb,
+                     void *cb_data)
+{
+    struct seg_tx *tx = NULL;
+    size_t upper_len = len + TRANS_MIC_LEN;
+    u8_t upper[TX_SEG_MAX * TRANS_SEG_LEN];
+
+    if (upper_len > sizeof(upper)) {
+        return -EMSGSIZE;
+    }
+    for (unsigned i = 0; i < ARRAY_SIZE(_seg_tx); i++) {
+        if (!_seg_tx[i].busy) {
+            tx = &_seg_tx[i];
+            break;
+        }
+    }
+    if (tx == NULL) {
+        return -EBUSY;
+    }
+    memcpy(upper, sdu, len);
+    memset(&upper[len], 0, TRANS_MIC_LEN);
+
+    u8_t ttl = net_tx->ctx->send_ttl;
+    tx->busy = true;
+    tx->sub = net_tx->sub;
+    tx->src = net_tx->src;
+    tx->dst = net_tx->ctx->addr;
+    tx->ttl = (ttl == BT_MESH_TTL_DEFAULT) ? host_default_ttl() : ttl;
+    tx->seg_n = (u8_t)((upper_len - 1) / TRANS_SEG_LEN);
+    tx->seq_zero = (u16_t)(bt_mesh.seq & 0x1fff);
+    tx->attempts = SEG_RETRANSMIT_ATTEMPTS;
+    tx->timeout = 0;
+    tx->cb = cb;
+    tx->cb_data = cb_data;
+
+    for (unsigned i = 0; i <= tx->seg_n; i++) {
+        struct os_mbuf *seg = host_adv_create(net_tx->xmit);
+        if (seg == NULL) {
+            /* out of segment buffers */
+            _seg_tx_reset(tx);
+            return -ENOBUFS;
+        }
+        size_t off = i * TRANS_SEG_LEN;
+        size_t seg_len = upper_len - off;
+        if (seg_len > TRANS_SEG_LEN) {
+            seg_len = TRANS_SEG_LEN;
+        }
+        net_buf_simple_init(seg, BT_MESH_NET_HDR_LEN);
+        net_buf_simple_add_u8(seg, 0x80 | TRANS_AKF);
+        net_buf_simple_add_u8(seg, (u8_t)((tx->seq_zero >> 6) & 0x7f));
+        net_buf_simple_add_u8(seg, (u8_t)(((tx->seq_zero & 0x3f) << 2) |
+                                          (i >> 3)));
+        net_buf_simple_add_u8(seg, (u8_t)(((i & 0x07) << 5) | tx->seg_n));
+        net_buf_simple_add_mem(seg, &upper[off], seg_len);
+
+        /* keep a reference for retransmissions */
+        tx->seg[i] = seg;
+        seg->om_ref++;
+        bt_mesh_net_send(net_tx, seg, (i == 0) ? &_seg_first_sent_cb
+                                               : &_seg_sent_cb, tx);
+    }
+    return 0;
+}
+
+int bt_mesh_trans_send(struct bt_mesh_net_tx *tx, const u8_t *sdu, size_t len,
+                       const struct bt_mesh_send_cb *cb, void *cb_data)
+{
+    if ((len + TRANS_MIC_LEN) > TRANS_UNSEG_LEN) {
+        return _send_seg(tx, sdu, len, cb, cb_data);
+    }
+
+    struct os_mbuf *buf = host_adv_create(tx->xmit);
+    if (buf == NULL) {
+        return -ENOBUFS;
+    }
+    net_buf_simple_init(buf, BT_MESH_NET_HDR_LEN);
+    net_buf_simple_add_u8(buf, TRANS_AKF);
+    net_buf_simple_add_mem(buf, sdu, len);
+    memset(net_buf_simple_add(buf, TRANS_MIC_LEN), 0, TRANS_MIC_LEN);
+    return bt_mesh_net_send(tx, buf, cb, cb_data);
+}
+
+static void _ack_recv(struct bt_mesh_net_rx *rx, const u8_t *pdu, size_t len)
+{
+    struct seg_tx *tx = NULL;
+
+    if (len < 6) {
+        return;
+    }
+    u16_t seq_zero = (u16_t)((((pdu[0] << 8) | pdu[1]) >> 2) & 0x1fff);
+    u32_t ack = ((u32_t)pdu[2] << 24) | ((u32_t)pdu[3] << 16) |
+                ((u32_t)pdu[4] << 8) | pdu[5];
+
+    for (unsigned i = 0; i < ARRAY_SIZE(_seg_tx); i++) {
+        if (_seg_tx[i].busy && (_seg_tx[i].seq_zero == seq_zero) &&
+            (_seg_tx[i].dst == rx->ctx.addr)) {
+            tx = &_seg_tx[i];
+            break;
+        }
+    }
+    if (tx == NULL) {
+        return;
+    }
+    if (ack == 0) {
+        /* the receiver canceled the message */
+        _seg_tx_complete(tx, -ECANCELED);
+        return;
+    }
+
+    tx->timeout = 0;
+    bool pending = false;
+    for (unsigned i = 0; i <= tx->seg_n; i++) {
+        if ((ack & (1UL << i)) && (tx->seg[i] != NULL)) {
+            host_adv_unref(tx->seg[i]);
+            tx->seg[i] = NULL;
+        }
+        pending |= (tx->seg[i] != NULL);
+    }
+    if (pending) {
+        _seg_tx_send_unacked(tx);
+    }
+    else {
+        _seg_tx_complete(tx, 0);
+    }
+}
+
+/* ---- incoming segmented messages ---------------------------------------- */
+
+static void _send_ack(u16_t src, u16_t dst, u16_t seq_zero, u32_t block)
+{
+    struct bt_mesh_msg_ctx ctx = {
+        .net_idx = bt_mesh.sub.net_idx,
+        .app_idx = BT_MESH_KEY_UNUSED,
+        .addr = dst,
+        .send_ttl = BT_MESH_TTL_DEFAULT,
+    };
+    struct bt_mesh_net_tx tx = {
+        .sub = &bt_mesh.sub,
+        .ctx = &ctx,
+        .src = src,
+        .xmit = bt_mesh_net_transmit_get(),
+    };
+
+    struct os_mbuf *buf = host_adv_create(tx.xmit);
+    if (buf == NULL) {
+        return;
+    }
+    net_buf_simple_init(buf, BT_MESH_NET_HDR_LEN);
+    net_buf_simple_add_u8(buf, TRANS_CTL_OP_ACK);
+    net_buf_simple_add_be16(buf, (u16_t)(seq_zero << 2));
+    net_buf_simple_add_be16(buf, (u16_t)(block >> 16));
+    net_buf_simple_add_be16(buf, (u16_t)block);
+    bt_mesh_net_send(&tx, buf, NULL, NULL);
+}
+
+static void _seg_ack(void *arg)
+{
+    struct seg_rx *rx = arg;
+
+    if (!rx->busy || (rx->ack_timeout != sim_now())) {
+        return;
+    }
+    kernel_pid_t pid = host_pid_enter();
+    _send_ack(rx->ctx.recv_dst, rx->ctx.addr, rx->seq_zero, rx->block);
+    rx->ack_timeout = sim_now() + SEG_ACK_TIMEOUT(rx->ctx.recv_ttl);
+    sim_call_at(rx->ack_timeout, _seg_ack, rx);
+    host_pid_leave(pid);
+}
+
+static void _seg_rx_timeout(void *arg)
+{
+    struct seg_rx *rx = arg;
+
+    if (rx->busy && (rx->rx_timeout == sim_now())) {
+        /* incomplete message, give up */
+        rx->busy = false;
+    }
+}
+
+static bool _rx_done_find(u16_t src, u16_t seq_zero)
+{
+    for (unsigned i = 0; i < SEG_RX_DONE_MAX; i++) {
+        if ((_rx_done[i].src == src) && (_rx_done[i].seq_zero == seq_zero)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static struct seg_rx *_seg_rx_get(struct bt_mesh_net_rx *net_rx,
+                                  u16_t seq_zero, u8_t seg_n)
+{
+    struct seg_rx *free_rx = NULL;
+
+    for (unsigned i = 0; i < ARRAY_SIZE(_seg_rx); i++) {
+        struct seg_rx *rx = &_seg_rx[i];
+        if (rx->busy && (rx->ctx.addr == net_rx->ctx.addr) &&
+            (rx->seq_zero == seq_zero)) {
+            return (rx->seg_n == seg_n) ? rx : NULL;
+        }
+        if (!rx->busy && (free_rx == NULL)) {
+            free_rx = &_seg_rx[i];
+        }
+    }
+    if (free_rx == NULL) {
+        /* no free slot for new incoming segmented messages */
+        return NULL;
+    }
+
+    free_rx->ctx = net_rx->ctx;
+    free_rx->seq_zero = seq_zero;
+    free_rx->seg_n = seg_n;
+    free_rx->busy = true;
+    free_rx->block = 0;
+    free_rx->len = 0;
+    free_rx->ack_timeout = 0;
+    free_rx->rx_timeout = sim_now() + SEG_RX_TIMEOUT;
+    sim_call_at(free_rx->rx_timeout, _seg_rx_timeout, free_rx);
+    return free_rx;
+}
+
+static void _seg_recv(struct bt_mesh_net_rx *net_rx, const u8_t *ltp,
+                      size_t len)
+{
+    if (net_rx->ctl || (len <= TRANS_SEG_HDR_LEN)) {
+        return;
+    }
+
+    u16_t seq_zero = (u16_t)(((ltp[1] & 0x7f) << 6) | (ltp[2] >> 2));
+    u8_t seg_o = (u8_t)(((ltp[2] & 0x03) << 3) | (ltp[3] >> 5));
+    u8_t seg_n = ltp[3] & 0x1f;
+    const u8_t *data = &ltp[TRANS_SEG_HDR_LEN];
+    size_t data_len = len - TRANS_SEG_HDR_LEN;
+    u16_t src = net_rx->ctx.addr;
+    u16_t dst = net_rx->ctx.recv_dst;
+    bool unicast = BT_MESH_ADDR_IS_UNICAST(dst);
+
+    if (seg_o > seg_n) {
+        return;
+    }
+    if (_rx_done_find(src, seq_zero)) {
+        if (unicast) {
+            _send_ack(dst, src, seq_zero, BLOCK_COMPLETE(seg_n));
+        }
+        return;
+    }
+    if (seg_n >= RX_SEG_MAX) {
+        /* too many segments, reject the message */
+        if (unicast) {
+            _send_ack(dst, src, seq_zero, 0);
+        }
+        return;
+    }
+
+    struct seg_rx *rx = _seg_rx_get(net_rx, seq_zero, seg_n);
+    if (rx == NULL) {
+        return;
+    }
+    if (seg_o == seg_n) {
+        rx->len = (seg_n * TRANS_SEG_LEN) + data_len;
+        if (rx->len > RX_SDU_MAX) {
+            rx->busy = false;
+            return;
+        }
+    }
+    else if (data_len != TRANS_SEG_LEN) {
+        return;
+    }
+    if (rx->block & (1UL << seg_o)) {
+        return;
+    }
+    memcpy(&rx->buf[seg_o * TRANS_SEG_LEN], data, data_len);
+    rx->block |= (1UL << seg_o);
+
+    if (unicast && (rx->ack_timeout == 0)) {
+        rx->ack_timeout = sim_now() + SEG_ACK_TIMEOUT(rx->ctx.recv_ttl);
+        sim_call_at(rx->ack_timeout, _seg_ack, rx);
+    }
+    if (rx->block != BLOCK_COMPLETE(seg_n)) {
+        return;
+    }
+
+    if (unicast) {
+        _send_ack(dst, src, seq_zero, rx->block);
+    }
+    _rx_done[_rx_done_next].src = src;
+    _rx_done[_rx_done_next].seq_zero = seq_zero;
+    _rx_done_next = (_rx_done_next + 1) % SEG_RX_DONE_MAX;
+    rx->busy = false;
+
+    if ((ltp[0] & TRANS_AKF) && (rx->len > TRANS_MIC_LEN)) {
+        host_access_recv(&rx->ctx, rx->buf, rx->len - TRANS_MIC_LEN);
+    }
+}
+
+int bt_mesh_trans_recv(struct os_mbuf *buf, struct bt_mesh_net_rx *rx)
+{
+    net_buf_simple_pull(buf, BT_MESH_NET_HDR_LEN);
+    if (buf->om_len < 1) {
+        return -EINVAL;
+    }
+
+    const u8_t *ltp = buf->om_data;
+    if (ltp[0] & 0x80) {
+        _seg_recv(rx, ltp, buf->om_len);
+    }
+    else if (rx->ctl) {
+        if ((ltp[0] & 0x7f) == TRANS_CTL_OP_ACK) {
+            _ack_recv(rx, &ltp[1], buf->om_len - 1);
+        }
+    }
+    else if ((ltp[0] & TRANS_AKF) &&
+             (buf->om_len > (1 + TRANS_MIC_LEN))) {
+        host_access_recv(&rx->ctx, &ltp[1], buf->om_len - 1 - TRANS_MIC_LEN);
+    }
+    return 0;
+}
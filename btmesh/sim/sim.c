@@ -0,0 +1,1210 @@
+/*
+ * Copyright (C) 2019 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Host-side multi-node simulator for the Bluetooth Mesh firmware
+ *
+ * Runs many instances of the mesh firmware in one process on top of a
+ * simulated advertising bearer driven by a discrete event clock. The nodes
+ * are not a model of the firmware: every node is a private copy of the node
+ * library, which is ../fw/main.c built against the host layer in host/ (see
+ * host/host.h). Each copy is loaded from its own memfd, so all static state
+ * of the firmware and of the host layer exists once per node.
+ *
+ * The firmware's main thread runs in a coroutine, blocking calls (xtimer,
+ * mutex, shell input) return to the event loop. Everything the mesh thread
+ * does on the board (receiving, relaying, segmentation timers) is called by
+ * the event loop directly. Nodes are controlled with the same shell commands
+ * the experiment scripts send to the testbed, and the output uses the
+ * serial_aggregator line format (`<time>;<node>;<line>`), so logs of
+ * simulated and real runs can be post-processed with the same tools.
+ *
+ * The bearer models the advertising behavior of NimBLE's mesh stack:
+ * - every network PDU is sent as (count + 1) advertising events, each event
+ *   consists of one frame on each of the three advertising channels
+ * - the controller adds a random delay of 0-10ms to every advertising event
+ * - the advertiser sends one buffer at a time, for its full duration
+ * - receivers scan continuously and hop the channel every scan window
+ * - frames overlapping at a receiver on the same channel collide and are
+ *   both lost, a node can not receive while it is transmitting
+ * - every link independently loses frames with a configurable probability
+ *
+ * @}
+ */
+
+#define _GNU_SOURCE
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <math.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include "sim.h"
+
+#define NODE_LIB                "btmesh-node.so"
+#define NODES_MAX               (1000U)
+#define NODE_STACK_SIZE         (64U * 1024U)
+#define NODE_INPUT_MAX          (32U)
+#define ADV_QUEUE_MAX           (256U)
+#define ADV_PDU_MAX             (31U)
+#define LUID_LEN                (16U)
+#define ELEM_PER_NODE           (3U)
+
+#define DEFAULT_XMIT            (0x0c)              /* BT_MESH_TRANSMIT(4, 20) */
+
+/* NimBLE mesh advertising and scanning parameters */
+#define ADV_INT_FAST            (20000U)
+#define ADV_DELAY_MAX           (10000U)
+#define ADV_CHAN_GAP            (150U)              /* channel switch */
+#define SCAN_WINDOW             (10000U)
+#define ADV_CHANNELS            (3U)
+
+/* air interface: LE 1M PHY, 1 byte preamble, 4 byte access address, 2 byte
+ * PDU header, 6 byte AdvA, 2 byte AD header, 3 byte CRC */
+#define PHY_US_PER_BYTE         (8U)
+#define ADV_FRAME_OVERHEAD      (1U + 4U + 2U + 6U + 2U + 3U)
+
+/* random geometric graphs are redrawn until they are connected */
+#define TOPO_TRIES              (1000U)
+
+enum {
+    EV_CMD,
+    EV_WAKE,
+    EV_CALL,
+    EV_TX_START,
+    EV_ADV,
+    EV_FRAME,
+    EV_RX_END,
+};
+
+enum {
+    ST_READY,
+    ST_RUNNING,
+    ST_SLEEP,
+    ST_BLOCKED,
+    ST_INPUT,
+    ST_HALTED,
+};
+
+typedef struct {
+    uint8_t data[ADV_PDU_MAX];
+    uint8_t len;
+} pdu_t;
+
+typedef struct {
+    pdu_t pdu;
+    uint8_t xmit;
+    void *ref;
+} advbuf_t;
+
+typedef struct {
+    uint64_t t;
+    uint64_t order;             /* FIFO order for events at the same time */
+    uint8_t type;
+    uint8_t chan;
+    unsigned node;
+    unsigned src;
+    unsigned boot;
+    unsigned aux;
+    void (*fn)(void *);
+    void *arg;
+    pdu_t pdu;
+} event_t;
+
+typedef struct {
+    unsigned id;
+    char name[16];
+    uint8_t luid[LUID_LEN];
+    uint8_t ble_addr[SIM_BLE_ADDR_LEN];
+
+    /* node library instance and main thread */
+    int lib_fd;
+    void *lib;
+    int (*main)(void);
+    host_rx_t rx;
+    host_adv_cb_t adv_cb;
+    host_is_sink_t is_sink;
+    unsigned boot;              /* invalidates events of earlier boots */
+    int state;
+    int reboot;
+    ucontext_t ctx;
+    char *stack;
+    unsigned wake_token;
+    char *input[NODE_INPUT_MAX];
+    unsigned input_head;
+    unsigned input_len;
+
+    /* advertising bearer */
+    advbuf_t txq[ADV_QUEUE_MAX];
+    unsigned txq_head;
+    unsigned txq_len;
+    int tx_active;
+    void *tx_ref;               /* buffer currently advertised */
+    uint64_t deaf_until;
+    uint32_t scan_phase;
+    int rx_busy;
+    int rx_corrupt;
+    uint64_t rx_end;
+    unsigned rx_token;
+
+    /* statistics */
+    unsigned tx_app;
+    unsigned rx_app;
+    unsigned adv_events;
+    unsigned frames;
+    unsigned collisions;
+    unsigned lost;
+    unsigned relay_drops;
+} node_t;
+
+static struct {
+    unsigned num;
+    char topo[64];
+    double loss;
+    int collisions;
+    int xmit_set;
+    uint8_t xmit;
+    int relay_xmit_set;
+    uint8_t relay_xmit;
+    int relay;
+    uint64_t seed;
+    const char *prefix;
+} _cfg = {
+    .num = 10,
+    .topo = "full",
+    .loss = 0.0,
+    .collisions = 1,
+    .xmit = DEFAULT_XMIT,
+    .relay_xmit = DEFAULT_XMIT,
+    .relay = 1,
+    .seed = 1,
+    .prefix = "nrf52dk",
+};
+
+static node_t *_nodes;
+static unsigned **_nbr;
+static unsigned *_nbr_len;
+
+static event_t *_evq;
+static size_t _evq_len;
+static size_t _evq_size;
+static uint64_t _evq_order;
+static uint64_t _now;
+
+static uint64_t _rng_state;
+
+static char **_cmds;
+static unsigned _cmds_len;
+
+static uint8_t *_lib_img;
+static size_t _lib_img_len;
+
+/* the node whose code is running, and whether that is its main thread */
+static node_t *_cur;
+static int _in_thread;
+static ucontext_t _sched_ctx;
+static jmp_buf _halt_jmp;
+
+static uint64_t _rand(void)
+{
+    /* xorshift64* */
+    _rng_state ^= _rng_state >> 12;
+    _rng_state ^= _rng_state << 25;
+    _rng_state ^= _rng_state >> 27;
+    return _rng_state * 0x2545f4914f6cdd1dULL;
+}
+
+static uint32_t _rand_range(uint32_t a, uint32_t b)
+{
+    return (b > a) ? (a + (uint32_t)(_rand() % (b - a))) : a;
+}
+
+static double _rand_unit(void)
+{
+    return (double)(_rand() >> 11) / (double)(1ULL << 53);
+}
+
+static void _fatal(const char *msg)
+{
+    fprintf(stderr, "err: %s%s%s\n", (_cur) ? _cur->name : "",
+            (_cur) ? ": " : "", msg);
+    exit(1);
+}
+
+static int _ev_before(const event_t *a, const event_t *b)
+{
+    return (a->t < b->t) || ((a->t == b->t) && (a->order < b->order));
+}
+
+static void _ev_push(event_t *ev)
+{
+    if (_evq_len == _evq_size) {
+        _evq_size = (_evq_size) ? (_evq_size * 2) : 1024;
+        _evq = realloc(_evq, _evq_size * sizeof(event_t));
+        if (_evq == NULL) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    ev->order = _evq_order++;
+    size_t i = _evq_len++;
+    while (i > 0) {
+        size_t p = (i - 1) / 2;
+        if (!_ev_before(ev, &_evq[p])) {
+            break;
+        }
+        _evq[i] = _evq[p];
+        i = p;
+    }
+    _evq[i] = *ev;
+}
+
+static int _ev_pop(event_t *ev)
+{
+    if (_evq_len == 0) {
+        return 0;
+    }
+    *ev = _evq[0];
+    event_t last = _evq[--_evq_len];
+    size_t i = 0;
+    for (;;) {
+        size_t c = (2 * i) + 1;
+        if (c >= _evq_len) {
+            break;
+        }
+        if ((c + 1 < _evq_len) && _ev_before(&_evq[c + 1], &_evq[c])) {
+            c++;
+        }
+        if (!_ev_before(&_evq[c], &last)) {
+            break;
+        }
+        _evq[i] = _evq[c];
+        i = c;
+    }
+    if (_evq_len > 0) {
+        _evq[i] = last;
+    }
+    return 1;
+}
+
+static void _schedule(uint64_t t, uint8_t type, const node_t *n, unsigned aux)
+{
+    event_t ev = { .t = t, .type = type, .node = n->id, .boot = n->boot,
+                   .aux = aux };
+    _ev_push(&ev);
+}
+
+/* ---- topology ----------------------------------------------------------- */
+
+static void _link(unsigned a, unsigned b)
+{
+    for (unsigned i = 0; i < _nbr_len[a]; i++) {
+        if (_nbr[a][i] == b) {
+            return;
+        }
+    }
+    _nbr[a][_nbr_len[a]++] = b;
+    _nbr[b][_nbr_len[b]++] = a;
+}
+
+static int _topo_connected(void)
+{
+    unsigned *seen = calloc(_cfg.num, sizeof(unsigned));
+    unsigned *queue = malloc(_cfg.num * sizeof(unsigned));
+    unsigned head = 0, tail = 0;
+
+    seen[0] = 1;
+    queue[tail++] = 0;
+    while (head < tail) {
+        unsigned a = queue[head++];
+        for (unsigned i = 0; i < _nbr_len[a]; i++) {
+            unsigned b = _nbr[a][i];
+            if (!seen[b]) {
+                seen[b] = 1;
+                queue[tail++] = b;
+            }
+        }
+    }
+    free(seen);
+    free(queue);
+    return (tail == _cfg.num);
+}
+
+/* random geometric graph in the unit square. Without a radius, the radius
+ * scales with the number of nodes so that the graph is connected with high
+ * probability, r = sqrt(2 * ln(n) / (pi * n)), about 12 neighbors per node.
+ * Graphs that are not connected are redrawn either way. */
+static int _topo_random(const char *arg)
+{
+    unsigned num = _cfg.num;
+    double r = (*arg == ':') ? atof(arg + 1)
+             : sqrt((2.0 * log((double)num)) / (M_PI * num));
+    double *x = malloc(num * sizeof(double));
+    double *y = malloc(num * sizeof(double));
+
+    for (unsigned tries = 0; tries < TOPO_TRIES; tries++) {
+        memset(_nbr_len, 0, num * sizeof(unsigned));
+        for (unsigned a = 0; a < num; a++) {
+            x[a] = _rand_unit();
+            y[a] = _rand_unit();
+        }
+        for (unsigned a = 0; a < num; a++) {
+            for (unsigned b = a + 1; b < num; b++) {
+                double dx = x[a] - x[b];
+                double dy = y[a] - y[b];
+                if (((dx * dx) + (dy * dy)) <= (r * r)) {
+                    _link(a, b);
+                }
+            }
+        }
+        if (_topo_connected()) {
+            free(x);
+            free(y);
+            fprintf(stderr, "sim: random topology, radius %.3f\n", r);
+            return 0;
+        }
+    }
+    free(x);
+    free(y);
+    fprintf(stderr, "err: no connected graph of %u nodes with radius %.3f, "
+            "use a larger radius\n", num, r);
+    return -1;
+}
+
+static int _topo_init(void)
+{
+    unsigned num = _cfg.num;
+
+    _nbr = calloc(num, sizeof(unsigned *));
+    _nbr_len = calloc(num, sizeof(unsigned));
+    for (unsigned i = 0; i < num; i++) {
+        _nbr[i] = calloc(num, sizeof(unsigned));
+    }
+
+    if (strcmp(_cfg.topo, "full") == 0) {
+        for (unsigned a = 0; a < num; a++) {
+            for (unsigned b = a + 1; b < num; b++) {
+                _link(a, b);
+            }
+        }
+    }
+    else if (strcmp(_cfg.topo, "line") == 0) {
+        for (unsigned a = 0; a + 1 < num; a++) {
+            _link(a, a + 1);
+        }
+    }
+    else if (strcmp(_cfg.topo, "grid") == 0) {
+        unsigned w = 1;
+        while ((w * w) < num) {
+            w++;
+        }
+        for (unsigned a = 0; a < num; a++) {
+            if (((a % w) + 1 < w) && (a + 1 < num)) {
+                _link(a, a + 1);
+            }
+            if (a + w < num) {
+                _link(a, a + w);
+            }
+        }
+    }
+    else if ((strcmp(_cfg.topo, "random") == 0) ||
+             (strncmp(_cfg.topo, "random:", 7) == 0)) {
+        return _topo_random(&_cfg.topo[6]);
+    }
+    else if (strncmp(_cfg.topo, "file:", 5) == 0) {
+        /* one link per line: <node a> <node b>, 1-based like the testbed */
+        FILE *f = fopen(&_cfg.topo[5], "r");
+        if (f == NULL) {
+            perror(&_cfg.topo[5]);
+            return -1;
+        }
+        unsigned a, b;
+        while (fscanf(f, "%u %u", &a, &b) == 2) {
+            if ((a == 0) || (b == 0) || (a > num) || (b > num) || (a == b)) {
+                fprintf(stderr, "err: invalid link %u-%u\n", a, b);
+                fclose(f);
+                return -1;
+            }
+            _link(a - 1, b - 1);
+        }
+        fclose(f);
+    }
+    else {
+        fprintf(stderr, "err: unknown topology '%s'\n", _cfg.topo);
+        return -1;
+    }
+    return 0;
+}
+
+/* ---- nodes -------------------------------------------------------------- */
+
+static void _lib_load(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if ((f == NULL) || (fseek(f, 0, SEEK_END) != 0)) {
+        perror(path);
+        exit(1);
+    }
+    _lib_img_len = (size_t)ftell(f);
+    _lib_img = malloc(_lib_img_len);
+    rewind(f);
+    if ((_lib_img == NULL) ||
+        (fread(_lib_img, 1, _lib_img_len, f) != _lib_img_len)) {
+        perror(path);
+        exit(1);
+    }
+    fclose(f);
+}
+
+static void _thread_entry(void)
+{
+    node_t *n = _cur;
+    n->main();
+    /* main() returned, the uc_link context takes over */
+    n->state = ST_HALTED;
+}
+
+static void _resume(node_t *n)
+{
+    _cur = n;
+    _in_thread = 1;
+    n->state = ST_RUNNING;
+    swapcontext(&_sched_ctx, &n->ctx);
+    _in_thread = 0;
+    _cur = NULL;
+}
+
+static void _yield(int state)
+{
+    node_t *n = _cur;
+    if (!_in_thread) {
+        _fatal("blocking call outside of the main thread");
+    }
+    n->state = state;
+    swapcontext(&n->ctx, &_sched_ctx);
+}
+
+static void _node_boot(node_t *n)
+{
+    /* every node loads its own copy of the library from its own memfd, the
+     * dynamic loader would share a library loaded twice from one file */
+    if (n->lib_fd < 0) {
+        n->lib_fd = memfd_create(n->name, 0);
+        if ((n->lib_fd < 0) ||
+            (write(n->lib_fd, _lib_img, _lib_img_len) != (ssize_t)_lib_img_len)) {
+            perror("memfd");
+            exit(1);
+        }
+    }
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/fd/%i", n->lib_fd);
+    n->lib = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (n->lib == NULL) {
+        fprintf(stderr, "err: %s\n", dlerror());
+        exit(1);
+    }
+    *(void **)&n->main = dlsym(n->lib, "main");
+    *(void **)&n->rx = dlsym(n->lib, "host_rx");
+    *(void **)&n->adv_cb = dlsym(n->lib, "host_adv_cb");
+    *(void **)&n->is_sink = dlsym(n->lib, "host_is_sink");
+    if (!n->main || !n->rx || !n->adv_cb || !n->is_sink) {
+        fprintf(stderr, "err: %s is not a node library\n", NODE_LIB);
+        exit(1);
+    }
+
+    /* paint the stack like RIOT does for its stack usage measurement */
+    uintptr_t *p = (uintptr_t *)n->stack;
+    while (p < (uintptr_t *)(n->stack + NODE_STACK_SIZE)) {
+        *p = (uintptr_t)p;
+        p++;
+    }
+    getcontext(&n->ctx);
+    n->ctx.uc_stack.ss_sp = n->stack;
+    n->ctx.uc_stack.ss_size = NODE_STACK_SIZE;
+    n->ctx.uc_link = &_sched_ctx;
+    makecontext(&n->ctx, _thread_entry, 0);
+
+    n->boot++;
+    n->state = ST_READY;
+    _schedule(_now, EV_WAKE, n, ++n->wake_token);
+}
+
+static void _node_stop(node_t *n)
+{
+    /* input sent while the node is down is lost, so is its radio state */
+    while (n->input_len > 0) {
+        free(n->input[n->input_head]);
+        n->input_head = (n->input_head + 1) % NODE_INPUT_MAX;
+        n->input_len--;
+    }
+    n->txq_len = 0;
+    n->tx_active = 0;
+    n->tx_ref = NULL;
+    n->rx_busy = 0;
+    n->rx_token++;
+    n->boot++;
+}
+
+static void _node_reboot(node_t *n)
+{
+    n->reboot = 0;
+    _node_stop(n);
+    dlclose(n->lib);
+    _node_boot(n);
+}
+
+/* calls into the node outside of its main thread, a failed assertion
+ * returns here and the node stays halted */
+static void _call_fn(node_t *n, void (*fn)(void *), void *arg)
+{
+    _cur = n;
+    if (setjmp(_halt_jmp) == 0) {
+        fn(arg);
+    }
+    _cur = NULL;
+}
+
+static void _call_rx(node_t *n, const pdu_t *pdu, const node_t *from)
+{
+    _cur = n;
+    if (setjmp(_halt_jmp) == 0) {
+        n->rx(pdu->data, pdu->len, from->ble_addr);
+    }
+    _cur = NULL;
+}
+
+static void _call_adv_cb(node_t *n, void *ref, int done)
+{
+    _cur = n;
+    if (setjmp(_halt_jmp) == 0) {
+        n->adv_cb(ref, done);
+    }
+    _cur = NULL;
+}
+
+/* ---- interface to the node library -------------------------------------- */
+
+uint64_t sim_now(void)
+{
+    return _now;
+}
+
+uint32_t sim_rand(void)
+{
+    return (uint32_t)_rand();
+}
+
+void sim_luid(void *buf, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        ((uint8_t *)buf)[i] = _cur->luid[i % LUID_LEN];
+    }
+}
+
+void sim_out(const char *line)
+{
+    printf("%" PRIu64 ".%06" PRIu64 ";%s;%s\n", _now / 1000000,
+           _now % 1000000, _cur->name, line);
+}
+
+void sim_stat_app(int tx)
+{
+    if (tx) {
+        _cur->tx_app++;
+    }
+    else {
+        _cur->rx_app++;
+    }
+}
+
+void sim_stat_relay_drop(void)
+{
+    _cur->relay_drops++;
+}
+
+void sim_mesh_cfg(uint8_t *relay, uint8_t *net_transmit,
+                  uint8_t *relay_retransmit)
+{
+    if (!_cfg.relay) {
+        *relay = 0;
+    }
+    if (_cfg.xmit_set) {
+        *net_transmit = _cfg.xmit;
+    }
+    if (_cfg.relay_xmit_set) {
+        *relay_retransmit = _cfg.relay_xmit;
+    }
+}
+
+int sim_ble_addr_of(const char *name, uint8_t *addr)
+{
+    for (unsigned i = 0; i < _cfg.num; i++) {
+        if (strcmp(_nodes[i].name, name) == 0) {
+            memcpy(addr, _nodes[i].ble_addr, SIM_BLE_ADDR_LEN);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+void sim_sleep_until(uint64_t t)
+{
+    _schedule(t, EV_WAKE, _cur, ++_cur->wake_token);
+    _yield(ST_SLEEP);
+}
+
+void sim_block(void)
+{
+    _yield(ST_BLOCKED);
+}
+
+void sim_wake(void)
+{
+    if (_cur->state == ST_BLOCKED) {
+        _cur->state = ST_READY;
+        _schedule(_now, EV_WAKE, _cur, ++_cur->wake_token);
+    }
+}
+
+size_t sim_shell_read(char *buf, size_t len)
+{
+    node_t *n = _cur;
+
+    while (n->input_len == 0) {
+        _yield(ST_INPUT);
+    }
+    char *line = n->input[n->input_head];
+    n->input_head = (n->input_head + 1) % NODE_INPUT_MAX;
+    n->input_len--;
+    strncpy(buf, line, len - 1);
+    buf[len - 1] = '\0';
+    free(line);
+    return strlen(buf);
+}
+
+void sim_reboot(void)
+{
+    _cur->reboot = 1;
+    _yield(ST_HALTED);
+}
+
+void sim_stack(char **start, int *size)
+{
+    *start = _cur->stack;
+    *size = (int)NODE_STACK_SIZE;
+}
+
+void sim_halt(void)
+{
+    node_t *n = _cur;
+
+    _node_stop(n);
+    n->state = ST_HALTED;
+    if (_in_thread) {
+        swapcontext(&n->ctx, &_sched_ctx);
+    }
+    longjmp(_halt_jmp, 1);
+}
+
+void sim_call_at(uint64_t t, void (*fn)(void *), void *arg)
+{
+    event_t ev = { .t = t, .type = EV_CALL, .node = _cur->id,
+                   .boot = _cur->boot, .fn = fn, .arg = arg };
+    _ev_push(&ev);
+}
+
+void sim_adv_send(const uint8_t *data, size_t len, uint8_t xmit, void *ref)
+{
+    node_t *n = _cur;
+
+    if ((len > ADV_PDU_MAX) || (n->txq_len == ADV_QUEUE_MAX)) {
+        _fatal("advertising queue overflow");
+    }
+    advbuf_t *buf = &n->txq[(n->txq_head + n->txq_len) % ADV_QUEUE_MAX];
+    memcpy(buf->pdu.data, data, len);
+    buf->pdu.len = (uint8_t)len;
+    buf->xmit = xmit;
+    buf->ref = ref;
+    n->txq_len++;
+    if (!n->tx_active) {
+        n->tx_active = 1;
+        _schedule(_now, EV_TX_START, n, 0);
+    }
+}
+
+/* ---- bearer ------------------------------------------------------------- */
+
+static void _on_tx_start(node_t *n)
+{
+    /* the previous buffer is done, the mesh stack releases it */
+    if (n->tx_ref != NULL) {
+        void *ref = n->tx_ref;
+        n->tx_ref = NULL;
+        _call_adv_cb(n, ref, 1);
+        if (n->state == ST_HALTED) {
+            return;
+        }
+    }
+    if (n->txq_len == 0) {
+        n->tx_active = 0;
+        return;
+    }
+
+    advbuf_t buf = n->txq[n->txq_head];
+    n->txq_head = (n->txq_head + 1) % ADV_QUEUE_MAX;
+    n->txq_len--;
+    n->tx_ref = buf.ref;
+    _call_adv_cb(n, buf.ref, 0);
+    if (n->state == ST_HALTED) {
+        return;
+    }
+
+    unsigned cnt = buf.xmit & 0x07;
+    uint32_t itvl = (((buf.xmit >> 3) + 1) * 10000U);
+    if (itvl < ADV_INT_FAST) {
+        itvl = ADV_INT_FAST;
+    }
+    uint64_t t = _now;
+    for (unsigned i = 0; i <= cnt; i++) {
+        event_t ev = { .t = t, .type = EV_ADV, .node = n->id,
+                       .boot = n->boot, .pdu = buf.pdu };
+        _ev_push(&ev);
+        t += itvl + _rand_range(0, ADV_DELAY_MAX);
+    }
+    /* the mesh stack keeps the buffer for the full advertising duration */
+    _schedule(_now + ((uint64_t)(cnt + 1) * (itvl + ADV_DELAY_MAX)),
+              EV_TX_START, n, 0);
+}
+
+static uint32_t _frame_airtime(const pdu_t *pdu)
+{
+    return (ADV_FRAME_OVERHEAD + pdu->len) * PHY_US_PER_BYTE;
+}
+
+static void _on_adv(node_t *n, const pdu_t *pdu)
+{
+    uint32_t air = _frame_airtime(pdu);
+
+    n->adv_events++;
+    n->deaf_until = _now + (ADV_CHANNELS * (air + ADV_CHAN_GAP));
+    /* a node can not receive while it is transmitting */
+    if (n->rx_busy) {
+        n->rx_corrupt = 1;
+    }
+    for (unsigned ch = 0; ch < ADV_CHANNELS; ch++) {
+        event_t ev = { .t = _now + (ch * (air + ADV_CHAN_GAP)),
+                       .type = EV_FRAME, .chan = (uint8_t)ch, .node = n->id,
+                       .pdu = *pdu };
+        _ev_push(&ev);
+    }
+}
+
+static unsigned _scan_chan(const node_t *n, uint64_t t)
+{
+    return (unsigned)(((t + n->scan_phase) / SCAN_WINDOW) % ADV_CHANNELS);
+}
+
+static void _on_frame(node_t *n, unsigned chan, const pdu_t *pdu)
+{
+    uint64_t end = _now + _frame_airtime(pdu);
+
+    n->frames++;
+    for (unsigned i = 0; i < _nbr_len[n->id]; i++) {
+        node_t *r = &_nodes[_nbr[n->id][i]];
+
+        if ((r->state == ST_HALTED) || (r->deaf_until > _now) ||
+            (_scan_chan(r, _now) != chan) || (_scan_chan(r, end) != chan)) {
+            continue;
+        }
+        if (r->rx_busy && (r->rx_end > _now)) {
+            if (_cfg.collisions) {
+                r->rx_corrupt = 1;
+                r->collisions++;
+            }
+            continue;
+        }
+        r->rx_busy = 1;
+        r->rx_corrupt = 0;
+        r->rx_end = end;
+        r->rx_token++;
+        event_t ev = { .t = end, .type = EV_RX_END, .node = r->id,
+                       .src = n->id, .aux = r->rx_token, .pdu = *pdu };
+        _ev_push(&ev);
+    }
+}
+
+static void _on_rx_end(node_t *n, unsigned token, unsigned src,
+                       const pdu_t *pdu)
+{
+    if (token != n->rx_token) {
+        return;
+    }
+    n->rx_busy = 0;
+    if (n->rx_corrupt) {
+        return;
+    }
+    if (_rand_unit() < _cfg.loss) {
+        n->lost++;
+        return;
+    }
+    _call_rx(n, pdu, &_nodes[src]);
+}
+
+/* ---- scenario ----------------------------------------------------------- */
+
+/* scenario lines use the syntax of the tmux send-keys calls in the
+ * experiment scripts: `<node>;<command>` targets a single node, a plain
+ * `<command>` is sent to all nodes, and `sleep <sec>` advances the clock */
+static int _scenario_load(FILE *f)
+{
+    char line[256];
+    uint64_t t = 0;
+    unsigned lineno = 0;
+
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        line[strcspn(line, "\r\n")] = '\0';
+        char *cmd = line + strspn(line, " \t");
+        if ((*cmd == '#') || (*cmd == '\0')) {
+            continue;
+        }
+        if (strncmp(cmd, "sleep ", 6) == 0) {
+            t += (uint64_t)(atof(&cmd[6]) * 1000000.0);
+            continue;
+        }
+
+        unsigned target = 0;
+        char *sep = strchr(cmd, ';');
+        if (sep) {
+            *sep = '\0';
+            char *dash = strrchr(cmd, '-');
+            target = dash ? (unsigned)atoi(dash + 1) : 0;
+            if ((target == 0) || (target > _cfg.num)) {
+                fprintf(stderr, "err: line %u: unknown node '%s'\n",
+                        lineno, cmd);
+                return -1;
+            }
+            cmd = sep + 1;
+        }
+
+        /* the command string is kept in a side table indexed by aux */
+        _cmds = realloc(_cmds, (_cmds_len + 1) * sizeof(char *));
+        if (_cmds == NULL) {
+            perror("realloc");
+            return -1;
+        }
+        _cmds[_cmds_len] = strdup(cmd);
+        event_t ev = { .t = t, .type = EV_CMD, .node = target,
+                       .aux = _cmds_len++ };
+        _ev_push(&ev);
+    }
+    return 0;
+}
+
+static void _on_cmd(unsigned target, unsigned idx)
+{
+    for (unsigned i = 0; i < _cfg.num; i++) {
+        node_t *n = &_nodes[i];
+        if ((target && (target != (i + 1))) || (n->state == ST_HALTED)) {
+            continue;
+        }
+        /* like a UART without flow control, input is lost when the node
+         * does not read it */
+        if (n->input_len == NODE_INPUT_MAX) {
+            continue;
+        }
+        n->input[(n->input_head + n->input_len) % NODE_INPUT_MAX] =
+            strdup(_cmds[idx]);
+        n->input_len++;
+        if (n->state == ST_INPUT) {
+            _resume(n);
+            if (n->reboot) {
+                _node_reboot(n);
+            }
+        }
+    }
+}
+
+/* ---- main --------------------------------------------------------------- */
+
+static void _summary(void)
+{
+    unsigned long tx = 0, rx = 0, adv = 0, coll = 0, lost = 0, qdrop = 0;
+    unsigned sinks = 0;
+    int *is_sink = calloc(_cfg.num, sizeof(int));
+
+    for (unsigned i = 0; i < _cfg.num; i++) {
+        node_t *n = &_nodes[i];
+        tx += n->tx_app;
+        rx += n->rx_app;
+        adv += n->adv_events;
+        coll += n->collisions;
+        lost += n->lost;
+        qdrop += n->relay_drops;
+        if (n->state != ST_HALTED) {
+            _cur = n;
+            is_sink[i] = n->is_sink();
+            _cur = NULL;
+            sinks += (is_sink[i]) ? 1 : 0;
+        }
+    }
+
+    /* a node does not receive its own messages, so a source that is a sink
+     * as well only counts against the other sinks */
+    double expected = 0;
+    for (unsigned i = 0; i < _cfg.num; i++) {
+        expected += (double)_nodes[i].tx_app * (sinks - (is_sink[i] ? 1 : 0));
+    }
+    free(is_sink);
+
+    fprintf(stderr, "sim: %u nodes, %u sinks, %.3f s simulated\n",
+            _cfg.num, sinks, (double)_now / 1000000.0);
+    fprintf(stderr, "sim: tx_app %lu rx_app %lu adv_events %lu "
+            "collisions %lu lost %lu qdrops %lu\n",
+            tx, rx, adv, coll, lost, qdrop);
+    if (expected > 0) {
+        fprintf(stderr, "sim: delivery ratio (all sinks) %.4f\n",
+                (double)rx / expected);
+    }
+}
+
+static void _usage(const char *prog)
+{
+    fprintf(stderr,
+        "usage: %s [options] <scenario file | ->\n"
+        "  -n <num>        number of nodes (default 10, max %u)\n"
+        "  -t <topology>   full | line | grid | random[:<radius>] | "
+        "file:<path>\n"
+        "  -l <prob>       per link frame loss probability (default 0)\n"
+        "  -C              disable the collision model\n"
+        "  -x <cnt>,<ms>   network transmit count and interval\n"
+        "  -r <cnt>,<ms>   relay retransmit count and interval\n"
+        "  -R              disable relaying\n"
+        "  -s <seed>       random seed (default 1)\n"
+        "  -p <prefix>     node name prefix (default nrf52dk)\n"
+        "Without -x and -r, the firmware's settings apply. Stack limits\n"
+        "(buffers, message cache, segments) are build options, see the\n"
+        "README.\n",
+        prog, NODES_MAX);
+}
+
+/* BT_MESH_TRANSMIT(cnt, ms) */
+static int _parse_xmit(const char *arg, uint8_t *xmit)
+{
+    unsigned c, ms;
+    if ((sscanf(arg, "%u,%u", &c, &ms) != 2) || (c > 7) ||
+        (ms < 10) || (ms > 320) || (ms % 10)) {
+        return -1;
+    }
+    *xmit = (uint8_t)(c | (((ms / 10) - 1) << 3));
+    return 0;
+}
+
+static void _nodes_init(void)
+{
+    /* node addresses are random unicast addresses, like the LUID based
+     * addresses the firmware uses, but with room for all elements of a
+     * node between them */
+    _nodes = calloc(_cfg.num, sizeof(node_t));
+    for (unsigned i = 0; i < _cfg.num; i++) {
+        node_t *n = &_nodes[i];
+        uint16_t addr;
+        int unique;
+        do {
+            addr = (uint16_t)_rand_range(1, 0x8000 - ELEM_PER_NODE);
+            unique = 1;
+            for (unsigned j = 0; j < i; j++) {
+                uint16_t other = (uint16_t)(_nodes[j].luid[0] |
+                                            (_nodes[j].luid[1] << 8));
+                unique &= (abs((int)addr - (int)other) >= (int)ELEM_PER_NODE);
+            }
+        } while (!unique);
+
+        n->id = i;
+        snprintf(n->name, sizeof(n->name), "%s-%u", _cfg.prefix, i + 1);
+        n->luid[0] = (uint8_t)addr;
+        n->luid[1] = (uint8_t)(addr >> 8);
+        for (unsigned b = 2; b < LUID_LEN; b++) {
+            n->luid[b] = (uint8_t)_rand();
+        }
+        for (unsigned b = 0; b < SIM_BLE_ADDR_LEN; b++) {
+            n->ble_addr[b] = (uint8_t)_rand();
+        }
+        n->ble_addr[0] |= 0xc0;     /* random static address */
+        n->scan_phase = _rand_range(0, SCAN_WINDOW * ADV_CHANNELS);
+        n->lib_fd = -1;
+        n->stack = malloc(NODE_STACK_SIZE);
+        if (n->stack == NULL) {
+            perror("malloc");
+            exit(1);
+        }
+    }
+
+    /* one memfd per node */
+    struct rlimit lim;
+    if ((getrlimit(RLIMIT_NOFILE, &lim) == 0) &&
+        (lim.rlim_cur < (_cfg.num + 64))) {
+        lim.rlim_cur = (lim.rlim_max < (_cfg.num + 64)) ? lim.rlim_max
+                                                        : (_cfg.num + 64);
+        setrlimit(RLIMIT_NOFILE, &lim);
+    }
+}
+
+static void _lib_find(char *path, size_t len)
+{
+    ssize_t res = readlink("/proc/self/exe", path, len - 1);
+    if (res < 0) {
+        perror("readlink");
+        exit(1);
+    }
+    path[res] = '\0';
+    char *dir_end = strrchr(path, '/');
+    *(dir_end + 1) = '\0';
+    if ((strlen(path) + strlen(NODE_LIB)) >= len) {
+        fprintf(stderr, "err: path too long\n");
+        exit(1);
+    }
+    strcat(path, NODE_LIB);
+}
+
+int main(int argc, char **argv)
+{
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:t:l:Cx:r:Rs:p:h")) != -1) {
+        switch (opt) {
+            case 'n':
+                _cfg.num = (unsigned)atoi(optarg);
+                break;
+            case 't':
+                strncpy(_cfg.topo, optarg, sizeof(_cfg.topo) - 1);
+                break;
+            case 'l':
+                _cfg.loss = atof(optarg);
+                break;
+            case 'C':
+                _cfg.collisions = 0;
+                break;
+            case 'x':
+                if (_parse_xmit(optarg, &_cfg.xmit)) {
+                    fprintf(stderr, "err: invalid network transmit\n");
+                    return 1;
+                }
+                _cfg.xmit_set = 1;
+                break;
+            case 'r':
+                if (_parse_xmit(optarg, &_cfg.relay_xmit)) {
+                    fprintf(stderr, "err: invalid relay retransmit\n");
+                    return 1;
+                }
+                _cfg.relay_xmit_set = 1;
+                break;
+            case 'R':
+                _cfg.relay = 0;
+                break;
+            case 's':
+                _cfg.seed = strtoull(optarg, NULL, 0);
+                break;
+            case 'p':
+                _cfg.prefix = optarg;
+                break;
+            default:
+                _usage(argv[0]);
+                return 1;
+        }
+    }
+    if ((optind >= argc) || (_cfg.num == 0) || (_cfg.num > NODES_MAX)) {
+        _usage(argv[0]);
+        return 1;
+    }
+
+    _rng_state = (_cfg.seed) ? _cfg.seed : 1;
+
+    char lib_path[512];
+    _lib_find(lib_path, sizeof(lib_path));
+    _lib_load(lib_path);
+
+    if (_topo_init() != 0) {
+        return 1;
+    }
+    _nodes_init();
+
+    FILE *f = (strcmp(argv[optind], "-") == 0) ? stdin
+                                               : fopen(argv[optind], "r");
+    if (f == NULL) {
+        perror(argv[optind]);
+        return 1;
+    }
+    if (_scenario_load(f) != 0) {
+        return 1;
+    }
+    if (f != stdin) {
+        fclose(f);
+    }
+
+    /* all nodes boot at time 0 */
+    for (unsigned i = 0; i < _cfg.num; i++) {
+        _node_boot(&_nodes[i]);
+    }
+
+    event_t ev;
+    while (_ev_pop(&ev)) {
+        _now = ev.t;
+        node_t *n = &_nodes[ev.node];
+        if ((ev.type != EV_CMD) && (ev.type != EV_FRAME) &&
+            (ev.type != EV_RX_END) &&
+            ((ev.boot != n->boot) || (n->state == ST_HALTED))) {
+            /* stale event of an earlier boot or of a halted node */
+            continue;
+        }
+        switch (ev.type) {
+            case EV_CMD:
+                _on_cmd(ev.node, ev.aux);
+                break;
+            case EV_WAKE:
+                if ((ev.aux == n->wake_token) &&
+                    ((n->state == ST_SLEEP) || (n->state == ST_READY))) {
+                    _resume(n);
+                    if (n->reboot) {
+                        _node_reboot(n);
+                    }
+                }
+                break;
+            case EV_CALL:
+                _call_fn(n, ev.fn, ev.arg);
+                break;
+            case EV_TX_START:
+                _on_tx_start(n);
+                break;
+            case EV_ADV:
+                _on_adv(n, &ev.pdu);
+                break;
+            case EV_FRAME:
+                _on_frame(n, ev.chan, &ev.pdu);
+                break;
+            case EV_RX_END:
+                _on_rx_end(n, ev.aux, ev.src, &ev.pdu);
+                break;
+        }
+    }
+
+    _summary();
+    return 0;
+}
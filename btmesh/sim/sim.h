@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2019 Freie Universität Berlin
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Interface between the simulator core and the per node host layer
+ *
+ * The core (sim.c) owns the event clock, the advertising bearer and the node
+ * threads. Every node is a private copy of the node library (../fw/main.c
+ * built against host/), which calls the sim_x() functions below. The core
+ * calls into a node through the host_x() entry points, always with that
+ * node selected as the current one.
+ *
+ * @}
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SIM_BLE_ADDR_LEN        (6U)
+
+/* functions provided by the core, acting on the current node */
+uint64_t sim_now(void);
+uint32_t sim_rand(void);
+void sim_luid(void *buf, size_t len);
+void sim_out(const char *line);
+void sim_stat_app(int tx);
+void sim_stat_relay_drop(void);
+void sim_mesh_cfg(uint8_t *relay, uint8_t *net_transmit,
+                  uint8_t *relay_retransmit);
+int sim_ble_addr_of(const char *name, uint8_t *addr);
+
+/* blocking calls, only allowed in the node's shell thread */
+void sim_sleep_until(uint64_t t);
+void sim_block(void);
+size_t sim_shell_read(char *buf, size_t len);
+void sim_reboot(void);
+void sim_stack(char **start, int *size);
+
+void sim_wake(void);
+void sim_halt(void);
+void sim_call_at(uint64_t t, void (*fn)(void *), void *arg);
+void sim_adv_send(const uint8_t *data, size_t len, uint8_t xmit, void *ref);
+
+/* entry points of the node library, called by the core */
+typedef void (*host_rx_t)(const uint8_t *data, size_t len,
+                          const uint8_t *adv_addr);
+typedef void (*host_adv_cb_t)(void *ref, int done);
+typedef int (*host_is_sink_t)(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_H */
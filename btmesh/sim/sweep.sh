@@ -0,0 +1,53 @@
+#! /bin/sh
+#
+# Copyright (C) 2019 Freie Universität Berlin
+#
+# Distributed under terms of the MIT license.
+#
+# Flooding scalability and retransmission sweeps with the host simulator:
+# node 1 publishes REQUESTS messages, all other nodes are sinks. Prints one
+# CSV line per run.
+
+######################################
+###    Experiment Configuration    ###
+######################################
+NODES="${NODES:-10 20 50 100 200 500}"
+# network transmit and relay retransmit settings as <count>,<interval ms>
+XMITS="${XMITS:-0,20 2,20 4,20 4,50 7,20}"
+TOPOLOGY="${TOPOLOGY:-random}"
+LOSS="${LOSS:-0.1}"
+REQUESTS=${REQUESTS:-100}
+DELAY_REQUEST=${DELAY_REQUEST:-1000000}     # in us
+DELAY_JITTER=${DELAY_JITTER:-500000}        # in us
+SEED=${SEED:-1}
+
+SIM="$(dirname $0)/bin/btmesh-sim"
+make -C "$(dirname $0)" > /dev/null || {
+    echo "building simulator failed!"
+    exit 1
+}
+
+# enough time for the last message to be flooded through the network
+TIMEOUT=$((REQUESTS * (DELAY_REQUEST + DELAY_JITTER) / 1000000 + 10))
+
+echo "nodes,xmit,topology,loss,tx_app,rx_app,adv_events,collisions,qdrops,delivery"
+for N in ${NODES}; do
+for X in ${XMITS}; do
+    RES=$( (
+        echo "nrf52dk-1;cfg_source"
+        echo "cfg_sink"
+        echo "nrf52dk-1;run_lvl ${REQUESTS} ${DELAY_REQUEST} ${DELAY_JITTER}"
+        echo "sleep ${TIMEOUT}"
+    ) | ${SIM} -n ${N} -t ${TOPOLOGY} -l ${LOSS} -x ${X} -r ${X} -s ${SEED} - \
+        2>&1 > /dev/null)
+    TX=$(echo "${RES}" | sed -n 's/.*tx_app \([0-9]*\).*/\1/p')
+    RX=$(echo "${RES}" | sed -n 's/.*rx_app \([0-9]*\).*/\1/p')
+    ADV=$(echo "${RES}" | sed -n 's/.*adv_events \([0-9]*\).*/\1/p')
+    COLL=$(echo "${RES}" | sed -n 's/.*collisions \([0-9]*\).*/\1/p')
+    QDROP=$(echo "${RES}" | sed -n 's/.*qdrops \([0-9]*\).*/\1/p')
+    RATIO=$(echo "${RES}" | sed -n 's/.*delivery ratio (all sinks) \(.*\)/\1/p')
+    echo "${N},\"${X}\",${TOPOLOGY},${LOSS},${TX},${RX},${ADV},${COLL},${QDROP},${RATIO}"
+done
+done
+
+exit 0
@@ -20,8 +20,14 @@
 
 #include <stdio.h>
 
+#include "tlsf.h"
 #include "tlsf-malloc.h"
+#include "irq.h"
 #include "msg.h"
+#include "mutex.h"
+#include "sched.h"
+#include "thread.h"
+#include "xtimer.h"
 #include "shell.h"
 #include "random.h"
 #include "ccn-lite-riot.h"
@@ -29,6 +35,7 @@
 #include "ccnl-callbacks.h"
 #include "ccnl-producer.h"
 #include "net/gnrc/netif.h"
+#include "net/netstats.h"
 
 
 /* main thread's message queue */
@@ -49,6 +56,16 @@ bool i_am_single_producer = 0;
 #endif
 static uint32_t _tlsf_heap[TLSF_BUFFER / sizeof(uint32_t)];
 
+/* heap bytes currently allocated and high-water mark, maintained by the
+ * malloc wrappers below (see LINKFLAGS in the Makefile) */
+static size_t _heap_used = 0;
+static size_t _heap_max = 0;
+
+/* runtime of each thread and system time at the start of the CPU
+ * measurement window, both in xtimer ticks */
+static uint64_t _cpu_ticks[KERNEL_PID_LAST + 1];
+static uint64_t _cpu_t_start = 0;
+
 
 #ifndef NUM_REQUESTS_NODE
 #define NUM_REQUESTS_NODE       (100u)
@@ -69,6 +86,115 @@ static uint32_t _tlsf_heap[TLSF_BUFFER / sizeof(uint32_t)];
 #define REQ_DELAY               (random_uint32_range(DELAY_MIN, DELAY_MAX))
 #endif
 
+/* in synchronized mode, all consumers start request round i at
+ * req_start + (i + 1) * DELAY_REQUEST plus a random offset within the
+ * spread window, so that Interests for the same name meet in the relays */
+#ifndef DELAY_SYNC_SPREAD
+#define DELAY_SYNC_SPREAD       (50000) // us
+#endif
+
+static bool _req_sync = false;
+static uint32_t _req_spread = DELAY_SYNC_SPREAD;
+
+/* relay counters, updated for every Interest from another node that is passed
+ * to the local producer */
+static unsigned _cnt_interests = 0;
+static unsigned _cnt_cs_hits = 0;
+static unsigned _cnt_pit_aggr = 0;
+static unsigned _cnt_pit_retrans = 0;
+static unsigned _cnt_produced = 0;
+
+/* the local producer function is always registered to see all Interests,
+ * consumers only disable content production */
+static bool _producer_enabled = true;
+
+/* Data payload size, set with `psize`. The payload is filled with a pattern
+ * derived from the content id, so consumers can verify what they receive.
+ * DATA_HDR_MAX leaves room for the name and the TLV headers. */
+#ifndef DATA_PAYLOAD_SIZE
+#define DATA_PAYLOAD_SIZE       (6U)
+#endif
+#define DATA_HDR_MAX            (64U)
+#define DATA_PAYLOAD_MAX        (CCNL_MAX_PACKET_SIZE - DATA_HDR_MAX)
+
+static unsigned _psize = DATA_PAYLOAD_SIZE;
+static unsigned char _payload[DATA_PAYLOAD_MAX];
+
+/* ccn-lite hands packets to the link layer as a whole and there is no
+ * fragmentation below it, Data larger than the link layer payload is dropped
+ * by the netif. Such packets are counted separately from the sent ones. */
+static kernel_pid_t _netif_pid = KERNEL_PID_UNDEF;
+static uint16_t _l2_mtu = 0;
+static unsigned _cnt_data_tx = 0;
+static unsigned _cnt_data_oversize = 0;
+
+/* estimated transmit airtime, split into packets this node originated
+ * (Interests of the local consumer, Data of the local producer) and packets
+ * it forwards or answers from its content store. Frames are counted as they
+ * are handed to the link layer, MAC retransmissions are not visible here. */
+#if ON_NRF
+/* nrfmin at 1 Mbit/s: preamble, address, length, nrfmin header (destination,
+ * source, protocol) and CRC */
+#define AIR_US_PER_BYTE         (8U)
+#define AIR_FRAME_OVERHEAD      (1U + 4U + 1U + 5U + 2U)
+#else
+/* IEEE 802.15.4 O-QPSK at 250 kbit/s: SHR and PHR, MAC header with
+ * compressed PAN ID and long addresses, FCS */
+#define AIR_US_PER_BYTE         (32U)
+#define AIR_FRAME_OVERHEAD      (6U + 3U + 2U + 8U + 8U + 2U)
+#endif
+
+enum {
+    AIR_ORIGIN,
+    AIR_RELAY,
+    AIR_NUMOF,
+};
+
+typedef struct {
+    unsigned frames;
+    uint32_t bytes;
+    uint32_t us;
+} air_cnt_t;
+
+static air_cnt_t _air[AIR_NUMOF];
+static const char *_air_names[AIR_NUMOF] = { "orig", "relay" };
+
+/* consumer: send time of the last REQ_TRACK_NUM requests, used to match
+ * received Data for latency and goodput. Data can arrive as long as the
+ * Interest is retransmitted, so the ring holds that many request rounds for
+ * up to REQ_TRACK_FIB_MAX prefixes. Pending requests that are overwritten
+ * anyway are counted as evicted. */
+#ifndef REQ_TRACK_FIB_MAX
+#define REQ_TRACK_FIB_MAX       (10U)
+#endif
+#define REQ_TRACK_WINDOW        ((CCNL_MAX_INTEREST_RETRANSMIT + 1U) * \
+                                 CCNL_INTEREST_RETRANS_TIMEOUT * 1000U)
+#define REQ_TRACK_ROUNDS        ((REQ_TRACK_WINDOW + DELAY_REQUEST - 1U) / \
+                                 DELAY_REQUEST)
+#define REQ_TRACK_NUM           (REQ_TRACK_ROUNDS * REQ_TRACK_FIB_MAX)
+#define REQ_NAME_LEN            (40U)
+
+typedef struct {
+    char name[REQ_NAME_LEN];
+    uint32_t t_sent;
+    bool pending;
+} req_track_t;
+
+static req_track_t _reqs[REQ_TRACK_NUM];
+static unsigned _req_next = 0;
+static mutex_t _req_lock = MUTEX_INIT;
+
+static unsigned _cnt_req = 0;
+static unsigned _cnt_req_evicted = 0;
+static unsigned _cnt_data_rx = 0;
+static unsigned _cnt_data_corrupt = 0;
+static uint32_t _data_rx_bytes = 0;
+static uint64_t _lat_sum = 0;
+static uint32_t _lat_min = UINT32_MAX;
+static uint32_t _lat_max = 0;
+static uint32_t _t_first_req = 0;
+static uint32_t _t_last_rx = 0;
+
 extern int _ccnl_interest(int argc, char **argv);
 
 static uint32_t _count_fib_entries(void) {
@@ -154,9 +280,482 @@ static int _stats(int argc, char **argv) {
 
     print_accumulated_stats();
 
+    printf("interests rx: %u\n", _cnt_interests);
+    printf("cs hits: %u\n", _cnt_cs_hits);
+    printf("pit aggregated: %u\n", _cnt_pit_aggr);
+    printf("pit retransmissions: %u\n", _cnt_pit_retrans);
+    printf("data produced: %u\n", _cnt_produced);
+
+    printf("payload size: %u\n", _psize);
+    printf("l2 mtu: %u\n", (unsigned)_l2_mtu);
+    printf("data tx: %u\n", _cnt_data_tx);
+    printf("data tx oversize: %u\n", _cnt_data_oversize);
+
+    netstats_t *l2;
+    if (gnrc_netapi_get(_netif_pid, NETOPT_STATS, NETSTATS_LAYER2,
+                        &l2, sizeof(&l2)) > 0) {
+        printf("l2 tx success: %u\n", (unsigned)l2->tx_success);
+        printf("l2 tx failed: %u\n", (unsigned)l2->tx_failed);
+        printf("l2 rx: %u\n", (unsigned)l2->rx_count);
+    }
+
+    mutex_lock(&_req_lock);
+    printf("data requested: %u\n", _cnt_req);
+    printf("req track evicted: %u\n", _cnt_req_evicted);
+    printf("data rx: %u\n", _cnt_data_rx);
+    printf("data corrupt: %u\n", _cnt_data_corrupt);
+    printf("data rx bytes: %lu\n", (unsigned long)_data_rx_bytes);
+    if (_cnt_data_rx > 0) {
+        uint32_t dur = _t_last_rx - _t_first_req;
+        printf("data latency avg: %lu\n",
+               (unsigned long)(_lat_sum / _cnt_data_rx));
+        printf("data latency min: %lu\n", (unsigned long)_lat_min);
+        printf("data latency max: %lu\n", (unsigned long)_lat_max);
+        if (dur > 0) {
+            printf("goodput bps: %lu\n", (unsigned long)(
+                   ((uint64_t)_data_rx_bytes * 8 * US_PER_SEC) / dur));
+        }
+    }
+    mutex_unlock(&_req_lock);
+
+    return 0;
+}
+
+static void _relay_stats_clear(void)
+{
+    _cnt_interests = 0;
+    _cnt_cs_hits = 0;
+    _cnt_pit_aggr = 0;
+    _cnt_pit_retrans = 0;
+    _cnt_produced = 0;
+    _cnt_data_tx = 0;
+    _cnt_data_oversize = 0;
+    memset(_air, 0, sizeof(_air));
+}
+
+static void _data_stats_clear(void)
+{
+    mutex_lock(&_req_lock);
+    memset(_reqs, 0, sizeof(_reqs));
+    _req_next = 0;
+    _cnt_req = 0;
+    _cnt_req_evicted = 0;
+    _cnt_data_rx = 0;
+    _cnt_data_corrupt = 0;
+    _data_rx_bytes = 0;
+    _lat_sum = 0;
+    _lat_min = UINT32_MAX;
+    _lat_max = 0;
+    mutex_unlock(&_req_lock);
+}
+
+static void _payload_fill(unsigned char *buf, unsigned len, unsigned id)
+{
+    for (unsigned i = 0; i < len; i++) {
+        buf[i] = (unsigned char)(id + i);
+    }
+}
+
+static bool _payload_check(const unsigned char *buf, unsigned len, unsigned id)
+{
+    if (len != _psize) {
+        return false;
+    }
+    for (unsigned i = 0; i < len; i++) {
+        if (buf[i] != (unsigned char)(id + i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static unsigned _comp_to_uint(const unsigned char *comp, int len)
+{
+    unsigned val = 0;
+    for (int i = 0; (i < len) && (comp[i] >= '0') && (comp[i] <= '9'); i++) {
+        val = (val * 10) + (comp[i] - '0');
+    }
+    return val;
+}
+
+static void _req_track(const char *name)
+{
+    mutex_lock(&_req_lock);
+    req_track_t *r = &_reqs[_req_next];
+    _req_next = (_req_next + 1) % REQ_TRACK_NUM;
+    if (r->pending) {
+        _cnt_req_evicted++;
+    }
+    strncpy(r->name, name, sizeof(r->name) - 1);
+    r->name[sizeof(r->name) - 1] = '\0';
+    r->t_sent = xtimer_now_usec();
+    r->pending = true;
+    if (_cnt_req++ == 0) {
+        _t_first_req = r->t_sent;
+    }
+    mutex_unlock(&_req_lock);
+    printf("tx interest %s\n", name);
+}
+
+static int _on_data_rx(struct ccnl_relay_s *relay, struct ccnl_face_s *from,
+                       struct ccnl_pkt_s *pkt)
+{
+    (void)relay;
+    (void)from;
+    char name[CCNL_MAX_PREFIX_SIZE];
+    uint32_t now = xtimer_now_usec();
+
+    ccnl_prefix_to_str(pkt->pfx, name, sizeof(name));
+
+    mutex_lock(&_req_lock);
+    for (unsigned i = 0; i < REQ_TRACK_NUM; i++) {
+        req_track_t *r = &_reqs[i];
+        if (strcmp(r->name, name) != 0) {
+            continue;
+        }
+        /* only Data for own requests is logged, relayed Data is not */
+        printf("rx data %s\n", name);
+        if (!r->pending) {
+            break;
+        }
+        /* the first Data for a name counts, duplicates are ignored */
+        r->pending = false;
+        uint32_t lat = now - r->t_sent;
+        unsigned id = _comp_to_uint(pkt->pfx->comp[pkt->pfx->compcnt - 1],
+                                    pkt->pfx->complen[pkt->pfx->compcnt - 1]);
+        if (!_payload_check(pkt->content, pkt->contlen, id)) {
+            _cnt_data_corrupt++;
+            break;
+        }
+        _cnt_data_rx++;
+        _data_rx_bytes += pkt->contlen;
+        _lat_sum += lat;
+        _lat_min = (lat < _lat_min) ? lat : _lat_min;
+        _lat_max = (lat > _lat_max) ? lat : _lat_max;
+        _t_last_rx = now;
+        break;
+    }
+    mutex_unlock(&_req_lock);
+
     return 0;
 }
 
+static int _on_data_tx(struct ccnl_relay_s *relay, struct ccnl_face_s *to,
+                       struct ccnl_pkt_s *pkt)
+{
+    (void)relay;
+
+    /* Data handed to the local application does not go over the air */
+    if ((to != NULL) && (to->ifndx < 0)) {
+        return 0;
+    }
+    if ((_l2_mtu > 0) && (pkt->buf != NULL) &&
+        (pkt->buf->datalen > _l2_mtu)) {
+        _cnt_data_oversize++;
+        return 0;
+    }
+    _cnt_data_tx++;
+    return 0;
+}
+
+static bool _req_pending(const char *name)
+{
+    bool pending = false;
+
+    mutex_lock(&_req_lock);
+    for (unsigned i = 0; i < REQ_TRACK_NUM; i++) {
+        if (_reqs[i].pending && (strcmp(_reqs[i].name, name) == 0)) {
+            pending = true;
+            break;
+        }
+    }
+    mutex_unlock(&_req_lock);
+    return pending;
+}
+
+/* returns true for Data of the local producer and for Interests the local
+ * consumer still waits for, including their retransmissions */
+static bool _pkt_originated(struct ccnl_buf_s *buf)
+{
+    unsigned char *data = buf->data;
+    size_t reslen = buf->datalen;
+    uint64_t typ;
+    unsigned int len;
+    char name[REQ_NAME_LEN];
+    size_t pos = 0;
+    bool own = false;
+
+    if (ccnl_ndntlv_dehead(&data, &reslen, &typ, &len) ||
+        ((typ != NDN_TLV_Interest) && (typ != NDN_TLV_Data))) {
+        return false;
+    }
+    bool interest = (typ == NDN_TLV_Interest);
+    if (ccnl_ndntlv_dehead(&data, &reslen, &typ, &len) ||
+        (typ != NDN_TLV_Name) || (len > reslen)) {
+        return false;
+    }
+
+    size_t namelen = len;
+    while (namelen > 0) {
+        size_t before = reslen;
+        if (ccnl_ndntlv_dehead(&data, &reslen, &typ, &len) ||
+            (len > reslen) || (((before - reslen) + len) > namelen)) {
+            return false;
+        }
+        namelen -= (before - reslen) + len;
+        if (pos == 0) {
+            own = ((len == strlen(hwaddr_str)) &&
+                   (memcmp(data, hwaddr_str, len) == 0));
+        }
+        if ((pos + 1 + len) < sizeof(name)) {
+            name[pos++] = '/';
+            memcpy(&name[pos], data, len);
+            pos += len;
+        }
+        data += len;
+        reslen -= len;
+    }
+    name[pos] = '\0';
+
+    return (interest) ? _req_pending(name) : own;
+}
+
+extern void __real_ccnl_ll_TX(struct ccnl_relay_s *ccnl, struct ccnl_if_s *ifc,
+                              sockunion *dest, struct ccnl_buf_s *buf);
+
+void __wrap_ccnl_ll_TX(struct ccnl_relay_s *ccnl, struct ccnl_if_s *ifc,
+                       sockunion *dest, struct ccnl_buf_s *buf)
+{
+    /* packets that exceed the link layer payload are dropped by the netif */
+    if ((buf != NULL) && ((_l2_mtu == 0) || (buf->datalen <= _l2_mtu))) {
+        unsigned bytes = buf->datalen + AIR_FRAME_OVERHEAD;
+        air_cnt_t *air = &_air[_pkt_originated(buf) ? AIR_ORIGIN : AIR_RELAY];
+        air->frames++;
+        air->bytes += bytes;
+        air->us += bytes * AIR_US_PER_BYTE;
+    }
+    __real_ccnl_ll_TX(ccnl, ifc, dest, buf);
+}
+
+static int _airtime(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    uint32_t total = 0;
+
+    for (unsigned i = 0; i < AIR_NUMOF; i++) {
+        printf("air %s frames: %u\n", _air_names[i], _air[i].frames);
+        printf("air %s bytes: %lu\n", _air_names[i],
+               (unsigned long)_air[i].bytes);
+        printf("air %s us: %lu\n", _air_names[i], (unsigned long)_air[i].us);
+        total += _air[i].us;
+    }
+    printf("air total us: %lu\n", (unsigned long)total);
+    /* only meaningful on consumers, the network wide value is the sum of
+     * all nodes' airtime over all consumers' received Data */
+    printf("app rx msgs: %u\n", _cnt_data_rx);
+    if (_cnt_data_rx > 0) {
+        printf("air us per rx msg: %lu\n",
+               (unsigned long)(total / _cnt_data_rx));
+    }
+
+    return 0;
+}
+
+static int _psize_cmd(int argc, char **argv)
+{
+    if (argc >= 2) {
+        unsigned size = (unsigned)atoi(argv[1]);
+        if ((size == 0) || (size > DATA_PAYLOAD_MAX)) {
+            printf("Error: payload size must be in [1, %u]\n",
+                   (unsigned)DATA_PAYLOAD_MAX);
+            return 1;
+        }
+        _psize = size;
+    }
+    printf("payload size: %u, l2 mtu: %u\n", _psize, (unsigned)_l2_mtu);
+    return 0;
+}
+
+extern void *__real_malloc(size_t size);
+extern void *__real_calloc(size_t nmemb, size_t size);
+extern void *__real_realloc(void *ptr, size_t size);
+extern void __real_free(void *ptr);
+
+static void _heap_account(size_t freed, size_t allocated)
+{
+    unsigned state = irq_disable();
+    _heap_used = _heap_used - freed + allocated;
+    if (_heap_used > _heap_max) {
+        _heap_max = _heap_used;
+    }
+    irq_restore(state);
+}
+
+void *__wrap_malloc(size_t size)
+{
+    void *ptr = __real_malloc(size);
+    _heap_account(0, tlsf_block_size(ptr));
+    return ptr;
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size)
+{
+    void *ptr = __real_calloc(nmemb, size);
+    _heap_account(0, tlsf_block_size(ptr));
+    return ptr;
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    size_t old = tlsf_block_size(ptr);
+    void *ptr_new = __real_realloc(ptr, size);
+    /* on failure the old block stays allocated */
+    if ((ptr_new != NULL) || (size == 0)) {
+        _heap_account(old, tlsf_block_size(ptr_new));
+    }
+    return ptr_new;
+}
+
+void __wrap_free(void *ptr)
+{
+    _heap_account(tlsf_block_size(ptr), 0);
+    __real_free(ptr);
+}
+
+typedef struct {
+    size_t used;
+    size_t free;
+    size_t free_max;
+    unsigned blocks_used;
+    unsigned blocks_free;
+} heap_walk_t;
+
+static void _heap_walker(void *ptr, size_t size, int used, void *user)
+{
+    (void)ptr;
+    heap_walk_t *hw = user;
+
+    if (used) {
+        hw->used += size;
+        hw->blocks_used++;
+    }
+    else {
+        hw->free += size;
+        hw->blocks_free++;
+        if (size > hw->free_max) {
+            hw->free_max = size;
+        }
+    }
+}
+
+static const char *_thread_name(kernel_pid_t pid)
+{
+#ifdef DEVELHELP
+    return thread_getname(pid);
+#else
+    (void)pid;
+    return "-";
+#endif
+}
+
+static int _mem(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+
+    /* _tlsf_heap is the first pool handed to TLSF, so the control structure
+     * lives at its start and the pool follows right behind */
+    heap_walk_t hw = { 0 };
+    unsigned state = irq_disable();
+    tlsf_walk_pool(tlsf_get_pool((tlsf_t)_tlsf_heap), _heap_walker, &hw);
+    size_t used_max = _heap_max;
+    irq_restore(state);
+
+    printf("heap size: %u\n", (unsigned)sizeof(_tlsf_heap));
+    printf("heap used: %u (%u blocks)\n", (unsigned)hw.used, hw.blocks_used);
+    printf("heap free: %u (%u blocks, largest %u)\n",
+           (unsigned)hw.free, hw.blocks_free, (unsigned)hw.free_max);
+    printf("heap used max: %u\n", (unsigned)used_max);
+
+#ifdef DEVELHELP
+    for (kernel_pid_t pid = KERNEL_PID_FIRST; pid <= KERNEL_PID_LAST; pid++) {
+        thread_t *t = (thread_t *)sched_threads[pid];
+        if (t == NULL) {
+            continue;
+        }
+        int unused = thread_measure_stack_free(t->stack_start);
+        printf("stack %s: used max %i of %i\n", _thread_name(pid),
+               t->stack_size - unused, t->stack_size);
+    }
+#endif
+
+    unsigned faces = 0;
+    for (struct ccnl_face_s *f = ccnl_relay.faces; f; f = f->next) {
+        faces++;
+    }
+    printf("cs entries: %i of %i\n", ccnl_relay.contentcnt,
+           ccnl_relay.max_cache_entries);
+    printf("pit entries: %i of %i\n", ccnl_relay.pitcnt,
+           ccnl_relay.max_pit_entries);
+    printf("fib entries: %u\n", (unsigned)_count_fib_entries());
+    printf("faces: %u\n", faces);
+
+    return 0;
+}
+
+static void _cpu_reset(void)
+{
+    unsigned state = irq_disable();
+    for (kernel_pid_t pid = KERNEL_PID_FIRST; pid <= KERNEL_PID_LAST; pid++) {
+        _cpu_ticks[pid] = sched_pidlist[pid].runtime_ticks;
+    }
+    _cpu_t_start = xtimer_now64().ticks64;
+    irq_restore(state);
+}
+
+static int _cpu(int argc, char **argv)
+{
+    if ((argc >= 2) && (strcmp(argv[1], "reset") == 0)) {
+        _cpu_reset();
+        return 0;
+    }
+
+    uint64_t busy[KERNEL_PID_LAST + 1];
+    unsigned state = irq_disable();
+    uint64_t window = xtimer_now64().ticks64 - _cpu_t_start;
+    for (kernel_pid_t pid = KERNEL_PID_FIRST; pid <= KERNEL_PID_LAST; pid++) {
+        uint64_t now = sched_pidlist[pid].runtime_ticks;
+        /* threads created within the window may reuse a PID */
+        busy[pid] = (now >= _cpu_ticks[pid]) ? (now - _cpu_ticks[pid]) : now;
+    }
+    irq_restore(state);
+
+    printf("cpu window: %lu ms\n",
+           (unsigned long)(xtimer_usec_from_ticks64(window) / US_PER_MS));
+    if (window == 0) {
+        return 0;
+    }
+    for (kernel_pid_t pid = KERNEL_PID_FIRST; pid <= KERNEL_PID_LAST; pid++) {
+        if (sched_threads[pid] == NULL) {
+            continue;
+        }
+        unsigned permille = (unsigned)((busy[pid] * 1000) / window);
+        printf("cpu %s: %u.%u%%\n", _thread_name(pid),
+               permille / 10, permille % 10);
+    }
+
+    return 0;
+}
+
+static void _req_sync_wait(xtimer_ticks32_t *last)
+{
+    xtimer_periodic_wakeup(last, DELAY_REQUEST);
+    if (_req_spread > 0) {
+        xtimer_usleep(random_uint32_range(0, _req_spread));
+    }
+}
+
 void *_consumer_event_loop(void *arg)
 {
     (void)arg;
@@ -166,12 +765,18 @@ void *_consumer_event_loop(void *arg)
     char s[CCNL_MAX_PREFIX_SIZE];
     int nodes_num = _count_fib_entries();
     uint32_t delay = 0;
+    xtimer_ticks32_t last = xtimer_now();
     for (unsigned i=0; i<NUM_REQUESTS_NODE; i++) {
+        if (_req_sync) {
+            _req_sync_wait(&last);
+        }
 #ifndef MULTI_HOP_SINGLEPRODUCER_MODE
         struct ccnl_forward_s *fwd;
         for (fwd = ccnl_relay.fib; fwd; fwd = fwd->next) {
-            delay = (uint32_t)((float)REQ_DELAY/(float)nodes_num);
-            xtimer_usleep(delay);
+            if (!_req_sync) {
+                delay = (uint32_t)((float)REQ_DELAY/(float)nodes_num);
+                xtimer_usleep(delay);
+            }
             ccnl_prefix_to_str(fwd->prefix,s,CCNL_MAX_PREFIX_SIZE);
 #if ON_NRF
             snprintf(req_uri, 12, "%s/%04d", s, i);// 12 is length of name
@@ -179,6 +784,7 @@ void *_consumer_event_loop(void *arg)
             snprintf(req_uri, 30, "%s/%04d", s, i);// 30 is length of name
 #endif
             a[1]= req_uri;
+            _req_track(req_uri);
             /* use shell function to send interest */
             _ccnl_interest(2, (char **)a);
         }
@@ -186,8 +792,10 @@ void *_consumer_event_loop(void *arg)
         (void)s;
         (void)nodes_num;
 
-        delay = (uint32_t)((float)REQ_DELAY);
-        xtimer_usleep(delay);
+        if (!_req_sync) {
+            delay = (uint32_t)((float)REQ_DELAY);
+            xtimer_usleep(delay);
+        }
 
         /* hard coded ID (mac address) of single producer */
 #if ON_NRF
@@ -196,28 +804,58 @@ void *_consumer_event_loop(void *arg)
         snprintf(req_uri, 30, "/15:11:6B:10:65:F7:8F:32/%04d", i);
 #endif
         a[1]= req_uri;
+        _req_track(req_uri);
         _ccnl_interest(2, (char **)a);
 #endif
     }
 
+    /* content production is only paused while this node requests */
+    _producer_enabled = true;
+
     return 0;
 }
 
 static int _req_start(int argc, char **argv)
 {
-    (void)argc;
-    (void)argv;
+    bool sync = false;
+    uint32_t spread = DELAY_SYNC_SPREAD;
+
+    if ((argc >= 2) && (strcmp(argv[1], "sync") == 0)) {
+        if (argc >= 3) {
+            spread = (uint32_t)atoi(argv[2]);
+        }
+        if (spread >= DELAY_REQUEST) {
+            puts("Error: spread must be smaller than the request delay");
+            return 1;
+        }
+        sync = true;
+    }
+    else if (argc >= 2) {
+        printf("usage: %s [sync [spread us]]\n", argv[0]);
+        return 1;
+    }
+    /* every req_start selects its mode, a plain one requests with jitter */
+    _req_sync = sync;
+    _req_spread = spread;
+
+    _cpu_reset();
+    _relay_stats_clear();
+    _data_stats_clear();
 
     if(!i_am_single_producer) {
-        /* unset local producer function for consumer node */
-        ccnl_set_local_producer(NULL);
+        /* disable local content production for consumer node */
+        _producer_enabled = false;
 
+        if (_req_sync) {
+            printf("sync requests, spread %lu us\n", (unsigned long)_req_spread);
+        }
         thread_create(consumer_stack, sizeof(consumer_stack),
                       CONSUMER_THREAD_PRIORITY,
                       THREAD_CREATE_STACKTEST, _consumer_event_loop,
                       NULL, "consumer");
     }
     else {
+        _producer_enabled = true;
         puts("I am single producer");
     }
     return 0;
@@ -228,6 +866,7 @@ static int _single_producer(int argc, char **argv) {
     (void)argv;
 
     i_am_single_producer = 1;
+    _producer_enabled = true;
     return 0;
 }
 
@@ -237,21 +876,25 @@ int produce_cont_and_cache(struct ccnl_relay_s *relay, struct ccnl_pkt_s *pkt, i
     char name[40];
     unsigned int offs = CCNL_MAX_PACKET_SIZE;
 
-    /* fake data to send back */
-    char buffer[33];
-    unsigned int len = sprintf(buffer, "{DATA}");
-    buffer[len]='\0';
+    /* data to send back, verified by the consumer */
+    unsigned int len = _psize;
+    _payload_fill(_payload, len, id);
 
     int name_len = sprintf(name, "/%s/%04d", hwaddr_str, id);
     name[name_len]='\0';
 
     struct ccnl_prefix_s *prefix = ccnl_URItoPrefix(name, CCNL_SUITE_NDNTLV, NULL);
     size_t reslen = 0;
-    ccnl_ndntlv_prependContent(prefix, (unsigned char*) buffer,
+    int res = ccnl_ndntlv_prependContent(prefix, _payload,
         len, NULL, NULL, &offs, _out, &reslen);
 
     ccnl_prefix_free(prefix);
 
+    if (res < 0) {
+        puts("ERROR payload does not fit into packet buffer");
+        return -1;
+    }
+
     unsigned char *olddata;
     unsigned char *data = olddata = _out + offs;
 
@@ -274,14 +917,62 @@ int produce_cont_and_cache(struct ccnl_relay_s *relay, struct ccnl_pkt_s *pkt, i
     return 0;
 }
 
+/* returns true if the Interest will be answered from the content store */
+static bool _count_interest(struct ccnl_relay_s *relay,
+                            struct ccnl_face_s *from, struct ccnl_pkt_s *pkt)
+{
+    /* Interests of the local consumer arrive over the loopback face, they
+     * are not received over the air and are not counted */
+    bool local = ((from != NULL) && (from->ifndx < 0));
+
+    if (!local) {
+        _cnt_interests++;
+    }
+
+    for (struct ccnl_content_s *c = relay->contents; c; c = c->next) {
+        if (ccnl_prefix_cmp(c->pkt->pfx, NULL, pkt->pfx, CMP_EXACT) == 0) {
+            if (!local) {
+                _cnt_cs_hits++;
+            }
+            return true;
+        }
+    }
+    if (local) {
+        return false;
+    }
+
+    for (struct ccnl_interest_s *i = relay->pit; i; i = i->next) {
+        if (ccnl_prefix_cmp(i->pkt->pfx, NULL, pkt->pfx, CMP_EXACT) != 0) {
+            continue;
+        }
+        /* a face that is already pending retransmits, any other face is
+         * aggregated into the existing entry */
+        for (struct ccnl_pendint_s *p = i->pending; p; p = p->next) {
+            if (p->face == from) {
+                _cnt_pit_retrans++;
+                return false;
+            }
+        }
+        _cnt_pit_aggr++;
+        return false;
+    }
+    return false;
+}
+
 int producer_func(struct ccnl_relay_s *relay, struct ccnl_face_s *from,
                    struct ccnl_pkt_s *pkt){
-    (void)from;
+    bool cached = _count_interest(relay, from, pkt);
+
+    if (!_producer_enabled || cached) {
+        return 0;
+    }
 
     if(pkt->pfx->compcnt == 2) { // /hwaddr/<val>
         /* match hwaddr */
         if (!memcmp(pkt->pfx->comp[0], hwaddr_str, pkt->pfx->complen[0])) {
-            return produce_cont_and_cache(relay, pkt, atoi((const char *)pkt->pfx->comp[1]));
+            _cnt_produced++;
+            return produce_cont_and_cache(relay, pkt,
+                _comp_to_uint(pkt->pfx->comp[1], pkt->pfx->complen[1]));
         }
     }
     return 0;
@@ -290,13 +981,18 @@ int producer_func(struct ccnl_relay_s *relay, struct ccnl_face_s *from,
 static const shell_command_t shell_commands[] = {
     { "sp", "prints accumulated stats", _single_producer },
     { "stats", "prints accumulated stats", _stats },
-    { "req_start", "start periodic content requests", _req_start },
+    { "req_start", "start periodic content requests [sync [spread us]]", _req_start },
+    { "psize", "set payload size of produced Data [bytes]", _psize_cmd },
+    { "airtime", "print estimated transmit airtime", _airtime },
+    { "mem", "print heap, stack and CS/PIT/FIB usage", _mem },
+    { "cpu", "print CPU share per thread since req_start [reset]", _cpu },
     { NULL, NULL, NULL }
 };
 
 int main(void)
 {
     tlsf_add_global_pool(_tlsf_heap, sizeof(_tlsf_heap));
+    _cpu_reset();
     msg_init_queue(_main_msg_queue, MAIN_QUEUE_SIZE);
 
     ccnl_core_init();
@@ -312,6 +1008,9 @@ int main(void)
         puts("Error registering at network interface!");
         return -1;
     }
+    _netif_pid = netif->pid;
+    gnrc_netapi_get(netif->pid, NETOPT_MAX_PACKET_SIZE, 0,
+                    &_l2_mtu, sizeof(_l2_mtu));
 
     /* MAC address length depends on hardware */
 #if ON_NRF
@@ -332,6 +1031,8 @@ int main(void)
     setup_forwarding(hwaddr_str);
 
     ccnl_set_local_producer(producer_func);
+    ccnl_set_cb_rx_on_data(_on_data_rx);
+    ccnl_set_cb_tx_on_data(_on_data_tx);
 
     char line_buf[SHELL_DEFAULT_BUFSIZE];
     shell_run(shell_commands, line_buf, SHELL_DEFAULT_BUFSIZE);
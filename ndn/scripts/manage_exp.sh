@@ -15,6 +15,12 @@ SACLAY_NODES="1-10"
 SINGLE_CONSUMER_OR_PRODUCER="${SINGLE_CONSUMER_OR_PRODUCER:-1}"
 
 REQUESTS=${REQUESTS:-100}
+# request timing of the consumers: empty for random jitter, "sync" or
+# "sync <spread us>" to align request rounds across nodes
+REQ_MODE="${REQ_MODE:-}"
+# Data payload sizes in bytes, each size is run after a reboot of all nodes
+# and logged to its own file, <experiment name>-<size>B.log
+PAYLOAD_SIZES="${PAYLOAD_SIZES:-6}"
 
 # extra USEMODULES and CFLAGS to build RIOT
 UMODS=""
@@ -114,7 +120,8 @@ fi
 # create log file name
 NUM_EXP_NODES=$(iotlab-experiment get -r | grep archi | wc -l)
 SUBMISSION_TIME=$(date +%d-%m-%Y"-"%H-%M)
-FILENAME="$nodetype-$exptype-$producer-$EXPID-$IOTLAB_SITE-$NUM_EXP_NODES-$((DELAY_REQUEST/1000000))sec-$REQUESTS-$SUBMISSION_TIME"
+REQ_MODE_NAME=$(echo "${REQ_MODE:-jitter}" | tr ' ' '_')
+FILENAME="$nodetype-$exptype-$producer-$REQ_MODE_NAME-$EXPID-$IOTLAB_SITE-$NUM_EXP_NODES-$((DELAY_REQUEST/1000000))sec-$REQUESTS-$SUBMISSION_TIME"
 echo "Experiment name is: ${FILENAME}"
 
 
@@ -125,48 +132,71 @@ tmux send-keys -t riot-${EXPID}:2 "pktcnt_p" C-m
 # iotlab-experiment stop -i ${EXPID} > /dev/null
 CMD
 )
-CMDS2=$(cat << CMD
-serial_aggregator -i ${EXPID} | tee ${FILENAME}.log
-CMD
-)
 fi
 
 if [ "${producer}" == "many" ]; then
 echo "MANY PRODUCERS"
-EXPCMDS=$(cat << CMD
+for PSIZE in ${PAYLOAD_SIZES}; do
+EXPCMDS="${EXPCMDS}
+$(cat << CMD
+tmux kill-window -t riot-${EXPID}:2 2> /dev/null
+tmux new-window -t riot-${EXPID}:2 "serial_aggregator -i ${EXPID} | tee ${FILENAME}-${PSIZE}B.log"
+sleep 3
 tmux send-keys -t riot-${EXPID}:2 "reboot" C-m
 sleep 5
-tmux send-keys -t riot-${EXPID}:2 "${nodetype}-${SINGLE_CONSUMER_OR_PRODUCER};req_start" C-m
+tmux send-keys -t riot-${EXPID}:2 "psize ${PSIZE}" C-m
+sleep 1
+tmux send-keys -t riot-${EXPID}:2 "${nodetype}-${SINGLE_CONSUMER_OR_PRODUCER};req_start ${REQ_MODE}" C-m
 sleep $(((($REQUESTS*$DELAY_REQUEST)/1000000)+40))
 tmux send-keys -t riot-${EXPID}:2 "stats" C-m
 sleep 5
-# iotlab-experiment stop -i ${EXPID} > /dev/null
+tmux send-keys -t riot-${EXPID}:2 "airtime" C-m
+sleep 5
+tmux send-keys -t riot-${EXPID}:2 "cpu" C-m
+sleep 5
+tmux send-keys -t riot-${EXPID}:2 "mem" C-m
+sleep 5
 CMD
-)
+)"
+done
+# iotlab-experiment stop -i ${EXPID} > /dev/null
 fi
 
 # the single procuder disables its consumer functionality. the subsequent req_start
 # command that is called for all nodes will not affect the single producer
 if [ "${producer}" == "one" ]; then
 echo "SINGLE PRODUCER"
-EXPCMDS=$(cat << CMD
+for PSIZE in ${PAYLOAD_SIZES}; do
+EXPCMDS="${EXPCMDS}
+$(cat << CMD
+tmux kill-window -t riot-${EXPID}:2 2> /dev/null
+tmux new-window -t riot-${EXPID}:2 "serial_aggregator -i ${EXPID} | tee ${FILENAME}-${PSIZE}B.log"
+sleep 3
 tmux send-keys -t riot-${EXPID}:2 "reboot" C-m
 sleep 5
+tmux send-keys -t riot-${EXPID}:2 "psize ${PSIZE}" C-m
+sleep 1
 tmux send-keys -t riot-${EXPID}:2 "${nodetype}-${SINGLE_CONSUMER_OR_PRODUCER};sp" C-m
 sleep 1
-tmux send-keys -t riot-${EXPID}:2 "req_start" C-m
+tmux send-keys -t riot-${EXPID}:2 "req_start ${REQ_MODE}" C-m
 sleep $(((($REQUESTS*$DELAY_REQUEST)/1000000)+40))
 tmux send-keys -t riot-${EXPID}:2 "stats" C-m
 sleep 5
-# iotlab-experiment stop -i ${EXPID} > /dev/null
+tmux send-keys -t riot-${EXPID}:2 "airtime" C-m
+sleep 5
+tmux send-keys -t riot-${EXPID}:2 "cpu" C-m
+sleep 5
+tmux send-keys -t riot-${EXPID}:2 "mem" C-m
+sleep 5
 CMD
-)
+)"
+done
+# iotlab-experiment stop -i ${EXPID} > /dev/null
 fi
 
 # connect to testbed via SSH and create tmux session that is logged to file
 ssh ${IOTLAB_USER}@${IOTLAB_SITE}.iot-lab.info -t << EOF
 tmux new-session -d -s riot-${EXPID} "${CMDS1}"
-tmux new-window -t riot-${EXPID}:2 "${CMDS2}"
 iotlab-node -i ${EXPID} --reset
 ${EXPCMDS}
 EOF
@@ -0,0 +1,695 @@
+/*
+ * Copyright (C) 2019 HAW Hamburg
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @{
+ *
+ * @file
+ * @brief       Parallel streaming analyzer for serial_aggregator logs
+ *
+ * Memory-maps a log written by `serial_aggregator | tee`, splits it into
+ * line-aligned chunks that are parsed by one thread each, and matches the
+ * resulting events in a second parallel pass that is sharded by message key.
+ *
+ * Recognized lines (`<timestamp>;<node>;<message>`):
+ * - mystats application events of the mesh firmware and the simulator,
+ *   `tx app <op> <value>` / `rx app <op> <value>`; a transmission and a
+ *   reception belong to the same message if they carry the same value, which
+ *   includes the source address
+ * - NDN consumer events, `tx interest <name>` / `rx data <name>`; Interests
+ *   and Data match by name
+ * - `stats` output, every `<key>: <number>` line is kept per node
+ * - the shell echo of `reboot` and `req_start`, which separates runs when
+ *   one log holds several of them; all results are reported per run
+ *
+ * Output is written as CSV: per-node and per-flow counters, delivery ratio,
+ * duplicates and latency, a time series of transmissions and deliveries,
+ * the collected stats values and the transmit airtime per delivered message.
+ *
+ * @}
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+enum class Kind : uint8_t {
+    MeshTx,
+    MeshRx,
+    NdnInterest,
+    NdnData,
+    Stat,
+    Run,
+};
+
+struct Event {
+    double ts;
+    Kind kind;
+    std::string_view node;
+    std::string_view key;       /* mesh value, NDN name or stats key */
+    std::string_view op;        /* mesh op name or stats value */
+    unsigned run = 0;
+};
+
+struct Options {
+    std::string log;
+    std::string out = "analysis";
+    unsigned threads = 0;
+    double bin = 1.0;
+};
+
+/* ---- parsing ------------------------------------------------------------ */
+
+bool is_space(char c)
+{
+    return (c == ' ') || (c == '\t') || (c == '\r');
+}
+
+std::string_view trim(std::string_view s)
+{
+    while (!s.empty() && is_space(s.front())) {
+        s.remove_prefix(1);
+    }
+    while (!s.empty() && is_space(s.back())) {
+        s.remove_suffix(1);
+    }
+    return s;
+}
+
+bool is_number(std::string_view s)
+{
+    if (s.empty()) {
+        return false;
+    }
+    size_t i = (s[0] == '-') ? 1 : 0;
+    bool digit = false;
+    for (; i < s.size(); i++) {
+        if ((s[i] >= '0') && (s[i] <= '9')) {
+            digit = true;
+        }
+        else if (s[i] != '.') {
+            return false;
+        }
+    }
+    return digit;
+}
+
+bool is_uint(std::string_view s)
+{
+    if (s.empty()) {
+        return false;
+    }
+    for (char c : s) {
+        if ((c < '0') || (c > '9')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t tokenize(std::string_view s, std::string_view *tok, size_t max)
+{
+    size_t n = 0;
+    size_t i = 0;
+    while ((i < s.size()) && (n < max)) {
+        while ((i < s.size()) && (is_space(s[i]) || (s[i] == ','))) {
+            i++;
+        }
+        size_t start = i;
+        while ((i < s.size()) && !is_space(s[i]) && (s[i] != ',')) {
+            i++;
+        }
+        if (i > start) {
+            tok[n++] = s.substr(start, i - start);
+        }
+    }
+    return n;
+}
+
+/* `tx app <op> <value>` / `rx app <op> <value>`, printed by mystats. The
+ * value holds the source address in its upper 16 bit (APP_VAL() in the mesh
+ * firmware), so equal values of different sources do not match */
+bool parse_mesh(std::string_view msg, Event &ev)
+{
+    std::string_view tok[5];
+    size_t n = tokenize(msg, tok, 5);
+
+    if ((n != 4) || !((tok[0] == "tx") || (tok[0] == "rx")) ||
+        (tok[1] != "app") || !is_uint(tok[3])) {
+        return false;
+    }
+    ev.kind = (tok[0] == "tx") ? Kind::MeshTx : Kind::MeshRx;
+    ev.op = tok[2];
+    ev.key = tok[3];
+    return true;
+}
+
+/* `tx interest <name>` / `rx data <name>`, printed by the NDN firmware for
+ * the Interests a consumer sends and the Data it receives for them */
+bool parse_ndn(std::string_view msg, Event &ev)
+{
+    std::string_view tok[4];
+    size_t n = tokenize(msg, tok, 4);
+
+    if ((n != 3) || (tok[2].size() < 2) || (tok[2][0] != '/')) {
+        return false;
+    }
+    if ((tok[0] == "tx") && (tok[1] == "interest")) {
+        ev.kind = Kind::NdnInterest;
+    }
+    else if ((tok[0] == "rx") && (tok[1] == "data")) {
+        ev.kind = Kind::NdnData;
+    }
+    else {
+        return false;
+    }
+    ev.key = tok[2];
+    return true;
+}
+
+/* the shell echo of `reboot` or `req_start` starts a new run */
+bool parse_run(std::string_view msg, Event &ev)
+{
+    std::string_view tok[1];
+    if ((tokenize(msg, tok, 1) != 1) ||
+        !((tok[0] == "reboot") || (tok[0] == "req_start"))) {
+        return false;
+    }
+    ev.kind = Kind::Run;
+    return true;
+}
+
+/* `<key>: <number>`, the key ends at the first colon */
+bool parse_stat(std::string_view msg, Event &ev)
+{
+    size_t sep = msg.find(':');
+    if ((sep == std::string_view::npos) || (sep == 0)) {
+        return false;
+    }
+    std::string_view key = trim(msg.substr(0, sep));
+    std::string_view val = trim(msg.substr(sep + 1));
+    if (key.empty() || !is_number(val) ||
+        !(std::isalpha((unsigned char)key[0]) || (key[0] == '_'))) {
+        return false;
+    }
+    ev.kind = Kind::Stat;
+    ev.key = key;
+    ev.op = val;
+    return true;
+}
+
+bool parse_line(std::string_view line, Event &ev)
+{
+    size_t s1 = line.find(';');
+    if (s1 == std::string_view::npos) {
+        return false;
+    }
+    size_t s2 = line.find(';', s1 + 1);
+    if (s2 == std::string_view::npos) {
+        return false;
+    }
+    std::string_view ts = line.substr(0, s1);
+    ev.node = line.substr(s1 + 1, s2 - s1 - 1);
+    std::string_view msg = trim(line.substr(s2 + 1));
+    /* strip the shell prompt the firmware echoes in front of its output */
+    while (!msg.empty() && (msg[0] == '>')) {
+        msg = trim(msg.substr(1));
+    }
+    if (msg.empty() || ev.node.empty()) {
+        return false;
+    }
+    char buf[32];
+    size_t len = std::min(ts.size(), sizeof(buf) - 1);
+    std::memcpy(buf, ts.data(), len);
+    buf[len] = '\0';
+    ev.ts = std::strtod(buf, nullptr);
+
+    return parse_mesh(msg, ev) || parse_ndn(msg, ev) || parse_run(msg, ev) ||
+           parse_stat(msg, ev);
+}
+
+void parse_chunk(const char *begin, const char *end, std::vector<Event> &out)
+{
+    const char *p = begin;
+    while (p < end) {
+        const char *nl = static_cast<const char *>(std::memchr(p, '\n', end - p));
+        const char *eol = nl ? nl : end;
+        Event ev;
+        if (parse_line(std::string_view(p, eol - p), ev)) {
+            out.push_back(ev);
+        }
+        p = eol + 1;
+    }
+}
+
+/* ---- matching ----------------------------------------------------------- */
+
+struct Latency {
+    std::vector<double> samples;
+
+    void add(double v) { samples.push_back(v); }
+
+    void merge(const Latency &o)
+    {
+        samples.insert(samples.end(), o.samples.begin(), o.samples.end());
+    }
+
+    double mean() const
+    {
+        if (samples.empty()) {
+            return NAN;
+        }
+        double sum = 0;
+        for (double v : samples) {
+            sum += v;
+        }
+        return sum / samples.size();
+    }
+
+    double pct(double p)
+    {
+        if (samples.empty()) {
+            return NAN;
+        }
+        size_t i = (size_t)std::min<double>(samples.size() - 1,
+                                            std::floor(p * samples.size()));
+        std::nth_element(samples.begin(), samples.begin() + i, samples.end());
+        return samples[i];
+    }
+};
+
+struct FlowStats {
+    bool mesh = false;
+    uint64_t tx = 0;
+    uint64_t delivered = 0;
+    uint64_t dups = 0;
+    Latency lat;
+
+    void merge(const FlowStats &o)
+    {
+        mesh |= o.mesh;
+        tx += o.tx;
+        delivered += o.delivered;
+        dups += o.dups;
+        lat.merge(o.lat);
+    }
+};
+
+struct NodeStats {
+    uint64_t tx = 0;
+    uint64_t rx = 0;
+    uint64_t dups = 0;
+    uint64_t interests = 0;
+    uint64_t data = 0;
+};
+
+using FlowKey = std::pair<std::string_view, std::string_view>;
+
+struct FlowKeyHash {
+    size_t operator()(const FlowKey &k) const
+    {
+        return std::hash<std::string_view>()(k.first) * 31 +
+               std::hash<std::string_view>()(k.second);
+    }
+};
+
+/* all results are kept per run */
+using NodeId = std::pair<unsigned, std::string_view>;
+using FlowId = std::pair<unsigned, FlowKey>;
+using SlotId = std::pair<unsigned, long>;
+
+struct Shard {
+    std::vector<const Event *> events;
+    std::map<FlowId, FlowStats> flows;
+    std::map<NodeId, NodeStats> nodes;
+    std::map<SlotId, std::pair<uint64_t, uint64_t>> series;
+};
+
+std::string_view ndn_prefix(std::string_view name)
+{
+    size_t end = name.find('/', 1);
+    return (end == std::string_view::npos) ? name : name.substr(0, end);
+}
+
+/* events of one shard are processed in log order; all events of a message
+ * end up in the same shard. Runs do not overlap, so the matching state is
+ * dropped whenever a new run starts */
+void match_shard(Shard &sh, double bin)
+{
+    struct TxRecord {
+        std::string_view node;
+        double ts;
+    };
+    std::unordered_map<std::string_view, std::vector<TxRecord>> mesh_tx;
+    /* a value is reused once the transaction ID wraps, receptions only
+     * count as duplicate within the same transmission generation */
+    std::unordered_map<FlowKey, size_t, FlowKeyHash> mesh_rx;
+    std::unordered_map<FlowKey, double, FlowKeyHash> ndn_req;
+    std::unordered_map<FlowKey, unsigned, FlowKeyHash> ndn_rcv;
+    unsigned run = 0;
+
+    for (const Event *ev : sh.events) {
+        if (ev->run != run) {
+            run = ev->run;
+            mesh_tx.clear();
+            mesh_rx.clear();
+            ndn_req.clear();
+            ndn_rcv.clear();
+        }
+        SlotId slot { run, (long)std::floor(ev->ts / bin) };
+        NodeStats &ns = sh.nodes[{ run, ev->node }];
+        switch (ev->kind) {
+            case Kind::MeshTx: {
+                mesh_tx[ev->key].push_back({ ev->node, ev->ts });
+                ns.tx++;
+                sh.series[slot].first++;
+                break;
+            }
+            case Kind::MeshRx: {
+                auto &txs = mesh_tx[ev->key];
+                std::string_view src = txs.empty() ? std::string_view("?")
+                                                   : txs.back().node;
+                FlowStats &fs = sh.flows[{ run, { src, ev->node } }];
+                fs.mesh = true;
+                auto rcv = mesh_rx.emplace(FlowKey { ev->key, ev->node },
+                                           txs.size());
+                if (!rcv.second && (rcv.first->second == txs.size())) {
+                    ns.dups++;
+                    fs.dups++;
+                    break;
+                }
+                rcv.first->second = txs.size();
+                ns.rx++;
+                fs.delivered++;
+                if (!txs.empty()) {
+                    fs.lat.add(ev->ts - txs.back().ts);
+                }
+                sh.series[slot].second++;
+                break;
+            }
+            case Kind::NdnInterest: {
+                FlowKey k { ev->node, ev->key };
+                ns.interests++;
+                /* retransmissions do not reset the request time */
+                if (ndn_req.emplace(k, ev->ts).second) {
+                    ns.tx++;
+                    sh.flows[{ run, { ndn_prefix(ev->key), ev->node } }].tx++;
+                    sh.series[slot].first++;
+                }
+                break;
+            }
+            case Kind::NdnData: {
+                FlowKey k { ev->node, ev->key };
+                FlowStats &fs = sh.flows[{ run, { ndn_prefix(ev->key),
+                                                  ev->node } }];
+                ns.data++;
+                if (ndn_rcv[k]++ > 0) {
+                    ns.dups++;
+                    fs.dups++;
+                    break;
+                }
+                ns.rx++;
+                fs.delivered++;
+                auto req = ndn_req.find(k);
+                if (req != ndn_req.end()) {
+                    fs.lat.add(ev->ts - req->second);
+                }
+                sh.series[slot].second++;
+                break;
+            }
+            case Kind::Stat:
+            case Kind::Run:
+                break;
+        }
+    }
+}
+
+template <typename F>
+void parallel_for(unsigned n, unsigned threads, F fn)
+{
+    std::vector<std::thread> pool;
+    std::atomic<unsigned> next(0);
+    for (unsigned t = 0; t < threads; t++) {
+        pool.emplace_back([&]() {
+            for (unsigned i = next++; i < n; i = next++) {
+                fn(i);
+            }
+        });
+    }
+    for (auto &th : pool) {
+        th.join();
+    }
+}
+
+std::string csv(std::string_view s)
+{
+    std::string out = "\"";
+    for (char c : s) {
+        out += (c == '"') ? "\"\"" : std::string(1, c);
+    }
+    return out + "\"";
+}
+
+int usage(const char *prog)
+{
+    std::fprintf(stderr,
+        "usage: %s [-j threads] [-b bin sec] [-o output prefix] <log file>\n"
+        "  writes <prefix>_nodes.csv, <prefix>_flows.csv,\n"
+        "  <prefix>_timeseries.csv, <prefix>_stats.csv and\n"
+        "  <prefix>_airtime.csv\n", prog);
+    return 1;
+}
+
+} /* namespace */
+
+int main(int argc, char **argv)
+{
+    Options opt;
+    int c;
+
+    while ((c = getopt(argc, argv, "j:b:o:h")) != -1) {
+        switch (c) {
+            case 'j':
+                opt.threads = (unsigned)std::atoi(optarg);
+                break;
+            case 'b':
+                opt.bin = std::atof(optarg);
+                break;
+            case 'o':
+                opt.out = optarg;
+                break;
+            default:
+                return usage(argv[0]);
+        }
+    }
+    if ((optind != argc - 1) || !(opt.bin > 0)) {
+        return usage(argv[0]);
+    }
+    opt.log = argv[optind];
+    if (opt.threads == 0) {
+        opt.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    auto t_start = std::chrono::steady_clock::now();
+
+    int fd = open(opt.log.c_str(), O_RDONLY);
+    struct stat st;
+    if ((fd < 0) || (fstat(fd, &st) != 0)) {
+        std::perror(opt.log.c_str());
+        return 1;
+    }
+    size_t size = (size_t)st.st_size;
+    const char *data = "";
+    if (size > 0) {
+        void *m = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (m == MAP_FAILED) {
+            std::perror("mmap");
+            return 1;
+        }
+        madvise(m, size, MADV_SEQUENTIAL);
+        data = static_cast<const char *>(m);
+    }
+
+    /* pass 1: parse line-aligned chunks in parallel */
+    unsigned chunks = opt.threads * 4;
+    std::vector<const char *> bounds(chunks + 1);
+    bounds[0] = data;
+    for (unsigned i = 1; i < chunks; i++) {
+        const char *p = std::max(bounds[i - 1], data + (size / chunks) * i);
+        const char *nl = static_cast<const char *>(
+            std::memchr(p, '\n', (data + size) - p));
+        bounds[i] = nl ? (nl + 1) : (data + size);
+    }
+    bounds[chunks] = data + size;
+
+    std::vector<std::vector<Event>> parsed(chunks);
+    parallel_for(chunks, opt.threads, [&](unsigned i) {
+        parse_chunk(bounds[i], bounds[i + 1], parsed[i]);
+    });
+
+    /* pass 2: number the runs, shard events by message key and keep log
+     * order within shards. All nodes echo a `reboot`, so a marker only
+     * starts a new run once messages were seen since the last one */
+    unsigned nshards = opt.threads * 4;
+    std::vector<Shard> shards(nshards);
+    std::map<std::tuple<unsigned, std::string_view, std::string_view>,
+             std::pair<std::string_view, uint64_t>> stats;
+    size_t total = 0;
+    unsigned run = 0;
+    bool active = false;
+    for (auto &chunk : parsed) {
+        total += chunk.size();
+        for (Event &ev : chunk) {
+            if (ev.kind == Kind::Run) {
+                run += active ? 1 : 0;
+                active = false;
+                continue;
+            }
+            ev.run = run;
+            if (ev.kind == Kind::Stat) {
+                auto &s = stats[{ ev.run, ev.node, ev.key }];
+                s.first = ev.op;
+                s.second++;
+                continue;
+            }
+            active = true;
+            size_t h = std::hash<std::string_view>()(ev.key);
+            shards[h % nshards].events.push_back(&ev);
+        }
+    }
+    parallel_for(nshards, opt.threads, [&](unsigned i) {
+        match_shard(shards[i], opt.bin);
+    });
+
+    /* merge */
+    std::map<NodeId, NodeStats> nodes;
+    std::map<FlowId, FlowStats> flows;
+    std::map<SlotId, std::pair<uint64_t, uint64_t>> series;
+    for (Shard &sh : shards) {
+        for (auto &n : sh.nodes) {
+            NodeStats &d = nodes[n.first];
+            d.tx += n.second.tx;
+            d.rx += n.second.rx;
+            d.dups += n.second.dups;
+            d.interests += n.second.interests;
+            d.data += n.second.data;
+        }
+        for (auto &f : sh.flows) {
+            flows[f.first].merge(f.second);
+        }
+        for (auto &s : sh.series) {
+            series[s.first].first += s.second.first;
+            series[s.first].second += s.second.second;
+        }
+    }
+    /* a mesh message is sent once but may reach every sink, so each flow
+     * of a source is measured against all of the source's transmissions */
+    for (auto &f : flows) {
+        auto n = nodes.find({ f.first.first, f.first.second.first });
+        if (f.second.mesh && (n != nodes.end())) {
+            f.second.tx = n->second.tx;
+        }
+    }
+
+    /* output */
+    std::ofstream fn(opt.out + "_nodes.csv");
+    fn << "run,node,tx,rx,dups,interests,data\n";
+    for (auto &n : nodes) {
+        fn << n.first.first << ',' << csv(n.first.second) << ','
+           << n.second.tx << ',' << n.second.rx << ','
+           << n.second.dups << ',' << n.second.interests << ','
+           << n.second.data << '\n';
+    }
+
+    std::ofstream ff(opt.out + "_flows.csv");
+    ff << "run,src,dst,tx,delivered,dups,delivery_ratio,"
+          "lat_mean_s,lat_p50_s,lat_p95_s,lat_max_s\n";
+    for (auto &f : flows) {
+        FlowStats &fs = f.second;
+        ff << f.first.first << ',' << csv(f.first.second.first) << ','
+           << csv(f.first.second.second) << ','
+           << fs.tx << ',' << fs.delivered << ',' << fs.dups << ','
+           << (fs.tx ? (double)fs.delivered / fs.tx : NAN) << ','
+           << fs.lat.mean() << ',' << fs.lat.pct(0.5) << ','
+           << fs.lat.pct(0.95) << ',' << fs.lat.pct(1.0) << '\n';
+    }
+
+    std::ofstream ft(opt.out + "_timeseries.csv");
+    ft << "run,t_s,tx,delivered\n";
+    for (auto &s : series) {
+        ft << s.first.first << ',' << (s.first.second * opt.bin) << ',' << s.second.first << ','
+           << s.second.second << '\n';
+    }
+
+    std::ofstream fs(opt.out + "_stats.csv");
+    fs << "run,node,key,value,samples\n";
+    for (auto &s : stats) {
+        fs << std::get<0>(s.first) << ',' << csv(std::get<1>(s.first)) << ','
+           << csv(std::get<2>(s.first)) << ','
+           << s.second.first << ',' << s.second.second << '\n';
+    }
+
+    /* the last `air total us` of a node in a run against its unique
+     * deliveries in that run, the `all` row of a run relates the airtime of
+     * the whole network to all deliveries */
+    std::map<NodeId, std::pair<uint64_t, uint64_t>> air;
+    for (auto &s : stats) {
+        if (std::get<2>(s.first) == "air total us") {
+            air[{ std::get<0>(s.first), std::get<1>(s.first) }].first =
+                std::strtoull(std::string(s.second.first).c_str(), nullptr, 10);
+        }
+    }
+    for (auto &n : nodes) {
+        air[n.first].second = n.second.rx;
+    }
+    std::ofstream fa(opt.out + "_airtime.csv");
+    fa << "run,node,air_us,delivered,air_us_per_delivered\n";
+    std::map<unsigned, std::pair<uint64_t, uint64_t>> air_all;
+    for (auto &a : air) {
+        fa << a.first.first << ',' << csv(a.first.second) << ','
+           << a.second.first << ',' << a.second.second << ','
+           << (a.second.second ? (double)a.second.first / a.second.second
+                               : NAN) << '\n';
+        air_all[a.first.first].first += a.second.first;
+        air_all[a.first.first].second += a.second.second;
+    }
+    for (auto &a : air_all) {
+        fa << a.first << ",all," << a.second.first << ',' << a.second.second
+           << ',' << (a.second.second ? (double)a.second.first / a.second.second
+                                      : NAN) << '\n';
+    }
+
+    auto t_end = std::chrono::steady_clock::now();
+    std::fprintf(stderr, "analyzed %zu bytes, %zu events, %u runs, "
+                 "%zu nodes, %zu flows in %.3f s using %u threads\n",
+                 size, total, run + 1, nodes.size(), flows.size(),
+                 std::chrono::duration<double>(t_end - t_start).count(),
+                 opt.threads);
+    return 0;
+}